@@ -0,0 +1,149 @@
+#include "Bitboard.h"
+
+static Bitboard slidingAttacks(int sq, Bitboard occupied, const int (&directions)[4][2])
+{
+	Bitboard attacks = 0;
+
+	for (const auto& dir : directions) {
+		int row = squareRow(sq) + dir[0];
+		int col = squareCol(sq) + dir[1];
+
+		// Walk the ray until the edge of the board or the first blocker
+		while (row >= 0 && row < 8 && col >= 0 && col < 8) {
+			Bitboard bb = squareBB(makeSquare(row, col));
+			attacks |= bb;
+			if (occupied & bb) break;
+			row += dir[0];
+			col += dir[1];
+		}
+	}
+
+	return attacks;
+}
+
+static const int bishopDirections[4][2] = { {1, 1}, {1, -1}, {-1, 1}, {-1, -1} };
+static const int rookDirections[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+
+// Every subset of each square's relevant blockers has an entry: 5248 in total
+// for bishops and 102400 for rooks
+static Bitboard bishopTable[0x1480];
+static Bitboard rookTable[0x19000];
+
+Magic bishopMagics[SQUARE_NB];
+Magic rookMagics[SQUARE_NB];
+
+static void initMagics(Magic (&magics)[SQUARE_NB], Bitboard* table, const int (&directions)[4][2])
+{
+	static Bitboard occupancy[4096], reference[4096];
+	int epoch[4096] = {};
+	// Seeds per row that are known to reach a magic quickly
+	static const uint64_t seeds[8] = { 728, 10316, 55888, 32803, 12281, 15100, 16645, 255 };
+	int attempt = 0;
+	uint64_t seed = 0;
+
+	// xorshift64* with fixed seeds, so every build finds the same magics
+	auto next = [&seed]() {
+		seed ^= seed >> 12;
+		seed ^= seed << 25;
+		seed ^= seed >> 27;
+		return seed * 2685821657736338717ULL;
+	};
+
+	for (int sq = 0; sq < SQUARE_NB; ++sq) {
+		Magic& m = magics[sq];
+
+		// A blocker on the board edge never shortens a ray, unless the piece stands on that edge
+		Bitboard edges = ((ROW_1_BB | ROW_8_BB) & ~(ROW_1_BB << (8 * squareRow(sq))))
+			| ((FILE_A_BB | FILE_H_BB) & ~(FILE_A_BB << squareCol(sq)));
+		m.mask = slidingAttacks(sq, 0, directions) & ~edges;
+		m.shift = 64 - popCount(m.mask);
+		m.attacks = table;
+		seed = seeds[squareRow(sq)];
+
+		// Enumerate every subset of the mask (Carry-Rippler) with its true attack set
+		int size = 0;
+		Bitboard b = 0;
+		do {
+			occupancy[size] = b;
+			reference[size] = slidingAttacks(sq, b, directions);
+			size++;
+			b = (b - m.mask) & m.mask;
+		} while (b);
+
+#if defined(__BMI2__)
+		for (int i = 0; i < size; ++i) {
+			table[m.index(occupancy[i])] = reference[i];
+		}
+#else
+		// Try random candidates until one sends every subset to a slot that is either
+		// unused or already holds the same attacks
+		for (int i = 0; i < size; ) {
+			// Candidates with few bits set make good magics far more often
+			do {
+				m.magic = next() & next() & next();
+			} while (popCount((m.magic * m.mask) >> 56) < 6);
+
+			for (++attempt, i = 0; i < size; ++i) {
+				unsigned idx = m.index(occupancy[i]);
+				if (epoch[idx] < attempt) {
+					epoch[idx] = attempt;
+					table[idx] = reference[i];
+				} else if (table[idx] != reference[i]) {
+					break;
+				}
+			}
+		}
+#endif
+
+		table += size;
+	}
+}
+
+static bool initSliderTables()
+{
+	initMagics(bishopMagics, bishopTable, bishopDirections);
+	initMagics(rookMagics, rookTable, rookDirections);
+	return true;
+}
+
+static const bool sliderTablesReady = initSliderTables();
+
+struct LineTables {
+	Bitboard between[SQUARE_NB][SQUARE_NB];
+	Bitboard line[SQUARE_NB][SQUARE_NB];
+};
+
+static LineTables makeLineTables()
+{
+	LineTables tables{};
+
+	for (int sq1 = 0; sq1 < SQUARE_NB; ++sq1) {
+		for (int sq2 = 0; sq2 < SQUARE_NB; ++sq2) {
+			Bitboard bb1 = squareBB(sq1), bb2 = squareBB(sq2);
+
+			// Two aligned squares see each other on an otherwise empty board, and the
+			// rays cast from both ends overlap exactly on the squares in between. Walking
+			// the rays keeps this table independent of the magic tables' initialization.
+			for (const auto* directions : { &rookDirections, &bishopDirections }) {
+				if (sq1 != sq2 && (slidingAttacks(sq1, 0, *directions) & bb2)) {
+					tables.between[sq1][sq2] = slidingAttacks(sq1, bb2, *directions) & slidingAttacks(sq2, bb1, *directions);
+					tables.line[sq1][sq2] = (slidingAttacks(sq1, 0, *directions) & slidingAttacks(sq2, 0, *directions)) | bb1 | bb2;
+				}
+			}
+		}
+	}
+
+	return tables;
+}
+
+static const LineTables lineTables = makeLineTables();
+
+Bitboard betweenBB(int sq1, int sq2)
+{
+	return lineTables.between[sq1][sq2];
+}
+
+Bitboard lineBB(int sq1, int sq2)
+{
+	return lineTables.line[sq1][sq2];
+}
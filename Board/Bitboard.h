@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include "Piece.h"
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+// One bit per square. Squares are numbered row * 8 + col, so (0, 0) is square 0
+// and (7, 7) is square 63; row 0 is White's back rank.
+using Bitboard = uint64_t;
+
+constexpr int SQUARE_NB = 64;
+constexpr int NO_SQUARE = -1;
+
+constexpr Bitboard FILE_A_BB = 0x0101010101010101ULL;
+constexpr Bitboard FILE_H_BB = FILE_A_BB << 7;
+constexpr Bitboard ROW_1_BB = 0xFFULL;
+constexpr Bitboard ROW_8_BB = ROW_1_BB << 56;
+
+constexpr int makeSquare(int row, int col) { return row * 8 + col; }
+constexpr int squareRow(int sq) { return sq >> 3; }
+constexpr int squareCol(int sq) { return sq & 7; }
+constexpr Bitboard squareBB(int sq) { return Bitboard(1) << sq; }
+
+inline int popCount(Bitboard b) { return std::popcount(b); }
+inline int lsb(Bitboard b) { return std::countr_zero(b); }
+
+inline int popLsb(Bitboard& b)
+{
+	int sq = lsb(b);
+	b &= b - 1;
+	return sq;
+}
+
+constexpr Bitboard shiftBB(Bitboard b, int row_step, int col_step)
+{
+	// Drop squares that would wrap around the board edge before shifting
+	if (col_step > 0) {
+		for (int i = 0; i < col_step; i++) b &= ~(FILE_H_BB >> i);
+	} else if (col_step < 0) {
+		for (int i = 0; i < -col_step; i++) b &= ~(FILE_A_BB << i);
+	}
+
+	int shift = row_step * 8 + col_step;
+	return (shift > 0) ? (b << shift) : (b >> -shift);
+}
+
+// Attacks of the pieces that do not slide depend only on the square, so they
+// are tabulated at compile time
+struct LeaperTables {
+	std::array<Bitboard, SQUARE_NB> knight{};
+	std::array<Bitboard, SQUARE_NB> king{};
+	std::array<Bitboard, SQUARE_NB> pawn[2]{}; // White, Black
+};
+
+constexpr LeaperTables makeLeaperTables()
+{
+	LeaperTables tables{};
+
+	for (int sq = 0; sq < SQUARE_NB; ++sq) {
+		Bitboard b = squareBB(sq);
+		tables.knight[sq] = shiftBB(b, 2, 1) | shiftBB(b, 2, -1) | shiftBB(b, -2, 1) | shiftBB(b, -2, -1)
+			| shiftBB(b, 1, 2) | shiftBB(b, 1, -2) | shiftBB(b, -1, 2) | shiftBB(b, -1, -2);
+		tables.king[sq] = shiftBB(b, 1, -1) | shiftBB(b, 1, 0) | shiftBB(b, 1, 1) | shiftBB(b, 0, -1)
+			| shiftBB(b, 0, 1) | shiftBB(b, -1, -1) | shiftBB(b, -1, 0) | shiftBB(b, -1, 1);
+		tables.pawn[0][sq] = shiftBB(b, 1, -1) | shiftBB(b, 1, 1);
+		tables.pawn[1][sq] = shiftBB(b, -1, -1) | shiftBB(b, -1, 1);
+	}
+
+	return tables;
+}
+
+inline constexpr LeaperTables Leapers = makeLeaperTables();
+
+constexpr Bitboard knightAttacks(int sq) { return Leapers.knight[sq]; }
+constexpr Bitboard kingAttacks(int sq) { return Leapers.king[sq]; }
+constexpr Bitboard pawnAttacks(PieceColor color, int sq) { return Leapers.pawn[color == PieceColor::White ? 0 : 1][sq]; }
+
+// Slider attacks are looked up by the blockers on the piece's rays. The relevant
+// occupancy is hashed to a dense index with a multiply and shift (magic
+// bitboards), or gathered directly with PEXT when the build targets BMI2.
+struct Magic {
+	Bitboard mask;
+	Bitboard magic;
+	const Bitboard* attacks;
+	unsigned shift;
+
+	unsigned index(Bitboard occupied) const
+	{
+#if defined(__BMI2__)
+		return static_cast<unsigned>(_pext_u64(occupied, mask));
+#else
+		return static_cast<unsigned>(((occupied & mask) * magic) >> shift);
+#endif
+	}
+};
+
+extern Magic bishopMagics[SQUARE_NB];
+extern Magic rookMagics[SQUARE_NB];
+
+inline Bitboard bishopAttacks(int sq, Bitboard occupied) { return bishopMagics[sq].attacks[bishopMagics[sq].index(occupied)]; }
+inline Bitboard rookAttacks(int sq, Bitboard occupied) { return rookMagics[sq].attacks[rookMagics[sq].index(occupied)]; }
+
+// Squares strictly between two squares on a common row, column or diagonal,
+// and the whole line through them; both are empty when the squares are not aligned
+Bitboard betweenBB(int sq1, int sq2);
+Bitboard lineBB(int sq1, int sq2);
@@ -1,538 +1,1311 @@
+#include <algorithm>
+#include <charconv>
 #include <iostream>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include "Board.h"
 #include "Piece.h"
 #include <memory>
-#include <limits>
 
 #undef min
 #undef max
 
-static std::shared_ptr<Board> board = std::make_shared<Board>();
-static int turn_counter = 1;
+const Piece* getPieceInstance(PieceColor color, PieceType type)
+{
+	static const Pawn pawns[] = { Pawn(PieceColor::White), Pawn(PieceColor::Black) };
+	static const Knight knights[] = { Knight(PieceColor::White), Knight(PieceColor::Black) };
+	static const Bishop bishops[] = { Bishop(PieceColor::White), Bishop(PieceColor::Black) };
+	static const Rook rooks[] = { Rook(PieceColor::White), Rook(PieceColor::Black) };
+	static const Queen queens[] = { Queen(PieceColor::White), Queen(PieceColor::Black) };
+	static const King kings[] = { King(PieceColor::White), King(PieceColor::Black) };
+
+	int idx = (color == PieceColor::White) ? 0 : 1;
+
+	switch (type) {
+	case PieceType::Pawn:
+		return &pawns[idx];
+	case PieceType::Knight:
+		return &knights[idx];
+	case PieceType::Bishop:
+		return &bishops[idx];
+	case PieceType::Rook:
+		return &rooks[idx];
+	case PieceType::Queen:
+		return &queens[idx];
+	case PieceType::King:
+		return &kings[idx];
+	default:
+		return nullptr;
+	}
+}
 
 void Board::initializePieceRow(int row, PieceColor color) {
-	m_layout[row][0] = std::make_shared<Rook>(color);
-	m_layout[row][1] = std::make_shared<Knight>(color);
-	m_layout[row][2] = std::make_shared<Bishop>(color);
-	m_layout[row][3] = std::make_shared<Queen>(color);
-	m_layout[row][4] = std::make_shared<King>(color);
-	m_layout[row][5] = std::make_shared<Bishop>(color);
-	m_layout[row][6] = std::make_shared<Knight>(color);
-	m_layout[row][7] = std::make_shared<Rook>(color);
+	static const PieceType backRank[COLS] = {
+		PieceType::Rook, PieceType::Knight, PieceType::Bishop, PieceType::Queen,
+		PieceType::King, PieceType::Bishop, PieceType::Knight, PieceType::Rook
+	};
+
+	for (int col = 0; col < COLS; ++col) {
+		putPiece(makeSquare(row, col), color, backRank[col]);
+	}
 }
 
 void Board::initializePawnRow(int row, PieceColor color) {
 	for (int col = 0; col < COLS; ++col) {
-		m_layout[row][col] = std::make_shared<Pawn>(color);
+		putPiece(makeSquare(row, col), color, PieceType::Pawn);
 	}
 }
 
 void Board::initializeEmptyRows() {
 	for (int row = 2; row <= 5; ++row) {
 		for (int col = 0; col < COLS; ++col) {
-			m_layout[row][col] = nullptr;
+			clearSquare(makeSquare(row, col));
 		}
 	}
 }
 
-static PieceColor getOpponentColor()
+void Board::putPiece(int sq, PieceColor color, PieceType type)
+{
+	Bitboard bb = squareBB(sq);
+	m_byType[static_cast<int>(PieceType::Empty)] |= bb;
+	m_byType[static_cast<int>(type)] |= bb;
+	m_byColor[static_cast<int>(color)] |= bb;
+	m_key ^= Zobrist.pieces[static_cast<int>(color)][static_cast<int>(type)][sq];
+	m_psqScore += PieceSquare.values[static_cast<int>(color)][static_cast<int>(type)][sq];
+	if (type == PieceType::Pawn) {
+		m_pawnKey ^= Zobrist.pieces[static_cast<int>(color)][static_cast<int>(type)][sq];
+	}
+	if (m_network) {
+		m_network->addPiece(*m_accumulator, color, type, sq);
+	}
+}
+
+void Board::clearSquare(int sq)
 {
-	if (turn_counter % 2 != 0) {
-		return PieceColor::Black;
+	if (!(occupied() & squareBB(sq))) {
+		return;
 	}
 
-	return PieceColor::White;
+	int color = static_cast<int>(colorAt(sq));
+	int type = static_cast<int>(pieceTypeAt(sq));
+	m_key ^= Zobrist.pieces[color][type][sq];
+	m_psqScore -= PieceSquare.values[color][type][sq];
+	if (type == static_cast<int>(PieceType::Pawn)) {
+		m_pawnKey ^= Zobrist.pieces[color][type][sq];
+	}
+	if (m_network) {
+		m_network->removePiece(*m_accumulator, static_cast<PieceColor>(color), static_cast<PieceType>(type), sq);
+	}
+
+	Bitboard mask = ~squareBB(sq);
+	for (Bitboard& bb : m_byType) bb &= mask;
+	for (Bitboard& bb : m_byColor) bb &= mask;
 }
 
-PieceColor getCurrentPlayerColor()
+uint64_t Board::computeKey() const
 {
-	if (turn_counter % 2 != 0) {
-		return PieceColor::White;
+	uint64_t key = 0;
+
+	Bitboard occ = occupied();
+	while (occ) {
+		int sq = popLsb(occ);
+		key ^= Zobrist.pieces[static_cast<int>(colorAt(sq))][static_cast<int>(pieceTypeAt(sq))][sq];
 	}
 
-	return PieceColor::Black;
+	key ^= Zobrist.castling[m_castlingRights];
+	if (m_epSquare != NO_SQUARE) {
+		key ^= Zobrist.enPassant[squareCol(m_epSquare)];
+	}
+	if (m_sideToMove == PieceColor::Black) {
+		key ^= Zobrist.side;
+	}
+
+	return key;
 }
 
-int getTurnCounter()
+void Board::setEnPassantSquare(int sq)
 {
-	return turn_counter;
+	if (m_epSquare != NO_SQUARE) {
+		m_key ^= Zobrist.enPassant[squareCol(m_epSquare)];
+	}
+	m_epSquare = sq;
+	if (m_epSquare != NO_SQUARE) {
+		m_key ^= Zobrist.enPassant[squareCol(m_epSquare)];
+	}
 }
 
-std::shared_ptr<Board> getBoard()
+PieceType Board::pieceTypeAt(int sq) const
 {
-	return board;
+	Bitboard bb = squareBB(sq);
+	if (!(occupied() & bb)) {
+		return PieceType::Empty;
+	}
+
+	for (int type = static_cast<int>(PieceType::Pawn); type <= static_cast<int>(PieceType::King); ++type) {
+		if (m_byType[type] & bb) {
+			return static_cast<PieceType>(type);
+		}
+	}
+
+	return PieceType::Empty;
+}
+
+PieceColor Board::colorAt(int sq) const
+{
+	Bitboard bb = squareBB(sq);
+	if (pieces(PieceColor::White) & bb) return PieceColor::White;
+	if (pieces(PieceColor::Black) & bb) return PieceColor::Black;
+	return PieceColor::Blank;
+}
+
+const Piece* Board::getPiece(int row, int col) const
+{
+	int sq = makeSquare(row, col);
+	return getPieceInstance(colorAt(sq), pieceTypeAt(sq));
+}
+
+void Board::setPiece(int row, int col, const Piece* piece)
+{
+	int sq = makeSquare(row, col);
+	clearSquare(sq);
+	if (piece) {
+		putPiece(sq, piece->getColor(), piece->getType());
+	}
+	m_checkers = computeCheckers();
 }
 
 Move Board::getLastMove() const 
 {
 	if (moveHistory.empty()) {
-		return Move{ -1, -1, -1, -1 }; // Return an invalid move if no moves have been made
+		return Move(); // Return an invalid move if no moves have been made
 	}
 	return moveHistory.back();
 }
 
 void Board::removePiece(int row, int col) 
 {
-	m_layout[row][col] = nullptr;
+	clearSquare(makeSquare(row, col));
+	m_checkers = computeCheckers();
 }
 
-std::shared_ptr<Piece> Board::replace(int src_row, int src_col, int trg_row, int trg_col)
+Bitboard Board::attackersTo(int sq, Bitboard occupied) const
 {
-	std::shared_ptr<Piece> src_piece = getPiece(src_row, src_col);
-	std::shared_ptr<Piece> dest_piece = getPiece(trg_row, trg_col);
-	setPiece(trg_row, trg_col, src_piece);
-	setPiece(src_row, src_col, nullptr);
+	// Look outwards from the square with each piece's attack pattern and intersect
+	// with the pieces that move that way
+	Bitboard queens = pieces(PieceType::Queen);
+	return (pawnAttacks(PieceColor::White, sq) & pieces(PieceColor::Black, PieceType::Pawn))
+		| (pawnAttacks(PieceColor::Black, sq) & pieces(PieceColor::White, PieceType::Pawn))
+		| (knightAttacks(sq) & pieces(PieceType::Knight))
+		| (kingAttacks(sq) & pieces(PieceType::King))
+		| (bishopAttacks(sq, occupied) & (pieces(PieceType::Bishop) | queens))
+		| (rookAttacks(sq, occupied) & (pieces(PieceType::Rook) | queens));
+}
 
-	return dest_piece;
+bool Board::isSquareAttacked(int row, int col, PieceColor color) const 
+{
+	// Is the square attacked by any piece of the side opposing color
+	int sq = makeSquare(row, col);
+	return (attackersTo(sq, occupied()) & pieces(oppositeColor(color))) != 0;
 }
 
-void Board::restore(int src_row, int src_col, int trg_row, int trg_col, std::shared_ptr<Piece> tmp_piece)
+const King* Board::getKing(PieceColor color, int &king_row, int& king_col) const
 {
-	std::shared_ptr<Piece> dest_piece = getPiece(trg_row, trg_col);
-	setPiece(trg_row, trg_col, tmp_piece);
-	setPiece(src_row, src_col, dest_piece);
+	Bitboard king = pieces(color, PieceType::King);
+	if (!king) {
+		return nullptr;
+	}
+
+	int sq = lsb(king);
+	king_row = squareRow(sq);
+	king_col = squareCol(sq);
+	return static_cast<const King*>(getPieceInstance(color, PieceType::King));
 }
 
-bool Board::isSquareAttacked(int row, int col, PieceColor color) const 
+bool Board::isKingInCheck(PieceColor color) const
 {
-	PieceColor opponentColor = getOpponentColor();
+	// If the king is not found, it's not a valid state, so return false
+	Bitboard king = pieces(color, PieceType::King);
+	if (!king) {
+		return false;
+	}
 
-	// Iterate over all squares on the board
-	for (int i = 0; i < ROWS; ++i) {
-		for (int j = 0; j < COLS; ++j) {
-			auto piece = getPiece(i, j);
+	// Check if any opponent's pieces threaten the king
+	return (attackersTo(lsb(king), occupied()) & pieces(oppositeColor(color))) != 0;
+}
 
-			// If the piece is null or not an opponent's piece, continue
-			if (!piece || piece->getColor() != opponentColor) {
-				continue;
-			}
+bool Board::isCheckmate() const
+{
+	// The side to move is mated when it is in check and has no legal move. Only this
+	// board's own state is used, so search threads can test their private copies.
+	return inCheck() && getLegalMoves().empty();
+}
 
-			// Handle pawn's attack moves separately
-			if (piece->getType() == PieceType::Pawn) {
-				int direction = (piece->getColor() == PieceColor::White) ? 1 : -1;
-				if (i + direction == row && (j - 1 == col || j + 1 == col)) {
-					return true;
-				}
-			} else {
-				// Check if the piece can move to (row, col)
-				if (piece->isValidMove(i, j, row, col)) {
-					return true;
-				}
-			}
-		}
+bool Board::isStalemate() const
+{
+	// If the king of the side to move is in check, it's not a stalemate
+	if (inCheck()) {
+		return false;
 	}
 
-	return false;
+	// If no legal moves are found, it's a stalemate
+	return getLegalMoves().empty();
 }
 
-std::shared_ptr<King> Board::getKing(PieceColor color, int &king_row, int& king_col) const
+void Board::updateCastlingRights(int src, int dest)
 {
-	for (int row = 0; row < ROWS; row++) {
-		for (int col = 0; col < COLS; col++) {
-			std::shared_ptr<Piece> piece = m_layout[row][col];
-			if (!piece) continue;
-			
-			if (piece->getType() == PieceType::King && piece->getColor() == color) {
-				std::shared_ptr<King> king = std::static_pointer_cast<King> (piece);
-				king_row = row;
-				king_col = col;
-				return king;
-			}
+	// A king or rook leaving its home square, or a rook being captured there, drops the right
+	static const int homeSquares[] = { makeSquare(0, 4), makeSquare(0, 7), makeSquare(0, 0),
+		makeSquare(7, 4), makeSquare(7, 7), makeSquare(7, 0) };
+	static const int lostRights[] = { CASTLE_WHITE_KINGSIDE | CASTLE_WHITE_QUEENSIDE, CASTLE_WHITE_KINGSIDE,
+		CASTLE_WHITE_QUEENSIDE, CASTLE_BLACK_KINGSIDE | CASTLE_BLACK_QUEENSIDE, CASTLE_BLACK_KINGSIDE,
+		CASTLE_BLACK_QUEENSIDE };
+
+	m_key ^= Zobrist.castling[m_castlingRights];
+	for (int i = 0; i < 6; ++i) {
+		if (src == homeSquares[i] || dest == homeSquares[i]) {
+			m_castlingRights &= ~lostRights[i];
 		}
 	}
+	m_key ^= Zobrist.castling[m_castlingRights];
+}
+
+MoveResult Board::evaluateGameState(const Move &move)
+{
+	// makeMove() has already handed the turn to the opponent
+	if (isKingInCheck(oppositeColor(m_sideToMove))) {
+		undoMove(move);
+		return MoveResult::KingInCheck;
+	}
 
-	return nullptr;
+	// One move generation decides both: no legal reply is mate when in check,
+	// stalemate otherwise
+	if (getLegalMoves().empty()) {
+		return inCheck() ? MoveResult::Checkmate : MoveResult::Stalemate;
+	}
+
+	// A mate delivered on the hundredth ply still counts, so the draws come second
+	if (isInsufficientMaterial()) {
+		return MoveResult::InsufficientMaterial;
+	}
+	if (m_halfmoveClock >= 100) {
+		return MoveResult::FiftyMoveRule;
+	}
+	if (isRepetition(0)) {
+		return MoveResult::Repetition;
+	}
+
+	m_turnCounter++;
+	return MoveResult::ValidMove;
 }
 
-bool Board::isKingInCheck(PieceColor color) const
+MoveResult Board::move(Move &move)
 {
-	// If the king is not found, it's not a valid state, so return false
-	int king_row = -1, king_col = -1;
-	std::shared_ptr<King> king = getKing(color, king_row, king_col);
-	if (!king) {
-		return false;
+	int src_row = move.srcRow(), src_col = move.srcCol();
+	int dest_row = move.destRow(), dest_col = move.destCol();
+	const Piece* piece = getPiece(src_row, src_col);
+
+	// Check if the player chose a piece
+	if (!piece) {
+		return MoveResult::InvalidPiece;
 	}
 
-	// Check if any opponent's pieces threaten the king
+	// Check if the player chose opponent's piece
+	if (piece->getColor() != m_sideToMove) {
+		return MoveResult::OpponentPiece;
+	}
 
-	for (int row = 0; row < ROWS; row++) {
-		for (int col = 0; col < COLS; col++) {
-			std::shared_ptr<Piece> piece = getPiece(row,col);
-			if (!piece) continue;
-			
-			if (piece->getColor() == king->getColor()) {
-				continue;
-			}
+	// The UI only knows the two squares; work out what kind of move it is
+	MoveFlag flag = MoveFlag::Normal;
 
-			if (piece->isValidMove(row, col, king_row, king_col)) {
-				return true;
-			}
+	// Handle castling move
+	if (piece->getType() == PieceType::King) {
+		const King* king = static_cast<const King*>(piece);
+		if (king->canCastle(*this, src_row, src_col, dest_row, dest_col)) {
+			flag = MoveFlag::Castling;
+		}
+	}
+
+	// Handle EnPassant move
+	if (piece->getType() == PieceType::Pawn) {
+		const Pawn* pawn = static_cast<const Pawn*>(piece);
+		if (pawn->isEnPassant(*this, src_row, src_col, dest_row, dest_col)) {
+			flag = MoveFlag::EnPassant;
+		}
+
+		// Pawns reaching the last row promote to a queen when the move came from a
+		// click; the engine's moves arrive flagged and keep the piece they chose
+		if (dest_row == 0 || dest_row == 7) {
+			flag = MoveFlag::Promotion;
 		}
 	}
 
-	return false; // King is not in check
+	// Check if the player chose a valid move for the corresponding Piece
+	bool is_special = (flag == MoveFlag::Castling || flag == MoveFlag::EnPassant);
+	if (!is_special && !piece->isValidMove(*this, src_row, src_col, dest_row, dest_col)) {
+		return MoveResult::InvalidMove;
+	}
+
+	// Encoded like the generated moves, so the two compare equal
+	if (flag == MoveFlag::Promotion) {
+		PieceType promotion = (move.flag() == MoveFlag::Promotion) ? move.promotion() : PieceType::Queen;
+		move = Move(move.from(), move.to(), flag, promotion);
+	} else {
+		move = Move(move.from(), move.to(), flag);
+	}
+	makeMove(move);
+	return MoveResult::ValidMove;
 }
 
-int Board::checkForPromotion(int dest_row, int dest_col)
+void Board::makeMove(const Move& move) 
 {
-	std::shared_ptr<Piece> tmp_piece = getPiece(dest_row, dest_col);
-	if (!tmp_piece) return 0;
+	int from = move.from();
+	int to = move.to();
+	PieceColor us = m_sideToMove;
+	PieceColor them = oppositeColor(us);
+	PieceType type = pieceTypeAt(from);
+	PieceType captured = pieceTypeAt(to);
+	int capture_sq = to;
+
+	// En passant captures the pawn beside the moving pawn, not on the target square
+	if (move.flag() == MoveFlag::EnPassant) {
+		captured = PieceType::Pawn;
+		capture_sq = makeSquare(squareRow(from), squareCol(to));
+	}
+
+	m_stateHistory.push_back(StateInfo{ captured, m_castlingRights, m_epSquare, m_halfmoveClock, m_key, m_checkers });
+	moveHistory.push_back(move);
+	if (us == PieceColor::Black) {
+		m_fullmoveNumber++;
+	}
+
+	// Captures and pawn moves cannot be undone, so no earlier position can come back
+	if (captured != PieceType::Empty || type == PieceType::Pawn) {
+		m_halfmoveClock = 0;
+	} else {
+		m_halfmoveClock++;
+	}
 
-	if (tmp_piece->getType() == PieceType::Pawn && (dest_row == 0 || dest_row == 7)) {
-		setPiece(dest_row, dest_col, std::make_shared<Queen>(getCurrentPlayerColor()));
-		return 1;
+	if (captured != PieceType::Empty) {
+		clearSquare(capture_sq);
+	}
+	clearSquare(from);
+	putPiece(to, us, (move.flag() == MoveFlag::Promotion) ? move.promotion() : type);
+
+	// Castling is encoded as a two square king move; bring the rook along
+	if (move.flag() == MoveFlag::Castling) {
+		int rook_from = makeSquare(squareRow(from), (squareCol(to) == 6) ? 7 : 0);
+		int rook_to = makeSquare(squareRow(from), (squareCol(to) == 6) ? 5 : 3);
+		clearSquare(rook_from);
+		putPiece(rook_to, us, PieceType::Rook);
 	}
 
-	return 0;
+	updateCastlingRights(from, to);
+
+	// Only record the en passant square when an enemy pawn can actually capture there
+	setEnPassantSquare(NO_SQUARE);
+	if (type == PieceType::Pawn && std::abs(to - from) == 16) {
+		int ep = (from + to) / 2;
+		if (pawnAttacks(us, ep) & pieces(them, PieceType::Pawn)) {
+			setEnPassantSquare(ep);
+		}
+	}
+
+	m_sideToMove = them;
+	m_key ^= Zobrist.side;
+
+	// Worked out once here so move generation and the search can both reuse it
+	m_checkers = computeCheckers();
 }
 
-bool Board::isCheckmate()
+void Board::undoMove(const Move& move) 
 {
-	PieceColor opp_color = getOpponentColor();
+	StateInfo state = m_stateHistory.back();
+	m_stateHistory.pop_back();
+	moveHistory.pop_back();
 
-	int king_row = -1, king_col = -1;
-	std::shared_ptr<King> king = getKing(opp_color, king_row, king_col);
-	// If the king is not found, it's not a valid state, so return false
-	if (!king) {
-		return false;
+	int from = move.from();
+	int to = move.to();
+	PieceColor us = oppositeColor(m_sideToMove);
+	PieceType type = (move.flag() == MoveFlag::Promotion) ? PieceType::Pawn : pieceTypeAt(to);
+
+	m_sideToMove = us;
+	if (us == PieceColor::Black) {
+		m_fullmoveNumber--;
+	}
+	m_castlingRights = state.castlingRights;
+	m_epSquare = state.epSquare;
+	m_halfmoveClock = state.halfmoveClock;
+	m_checkers = state.checkers;
+
+	clearSquare(to);
+	putPiece(from, us, type);
+
+	if (move.flag() == MoveFlag::Castling) {
+		int rook_from = makeSquare(squareRow(from), (squareCol(to) == 6) ? 7 : 0);
+		int rook_to = makeSquare(squareRow(from), (squareCol(to) == 6) ? 5 : 3);
+		clearSquare(rook_to);
+		putPiece(rook_from, us, PieceType::Rook);
 	}
 
-	// Check if the king is in check
-	if (!isKingInCheck(opp_color)) {
-		return false; // King is not in check, so it's not checkmate
+	if (state.captured != PieceType::Empty) {
+		int capture_sq = to;
+		if (move.flag() == MoveFlag::EnPassant) {
+			capture_sq = makeSquare(squareRow(from), squareCol(to));
+		}
+		putPiece(capture_sq, oppositeColor(us), state.captured);
 	}
 
-	// Check if the king has any legal moves to escape check
-	for (int row = king_row - 1; row <= king_row + 1; ++row) {
-		for (int col = king_col - 1; col <= king_col + 1; ++col) {
-			if (row >= 0 && row < ROWS && col >= 0 && col < COLS && !(row == king_row && col == king_col)) {
-				std::shared_ptr<Piece> piece = getPiece(row, col);
-				if (piece && piece->getColor() == opp_color) continue;
-				int dum_king_row = -1, dum_king_col = -1;
+	// Restore the key saved before the move rather than undoing each term
+	m_key = state.key;
+}
+
+// Passes the turn without moving, for null move pruning. The side to move must
+// not be in check. The null move is recorded as an invalid Move. It resets the
+// halfmove clock, so repetitions are never looked for across it.
+void Board::makeNullMove()
+{
+	m_stateHistory.push_back(StateInfo{ PieceType::Empty, m_castlingRights, m_epSquare, m_halfmoveClock, m_key, m_checkers });
+	moveHistory.push_back(Move());
+	m_halfmoveClock = 0;
+
+	setEnPassantSquare(NO_SQUARE);
+	m_sideToMove = oppositeColor(m_sideToMove);
+	m_key ^= Zobrist.side;
+	m_checkers = 0;
+}
+
+void Board::undoNullMove()
+{
+	StateInfo state = m_stateHistory.back();
+	m_stateHistory.pop_back();
+	moveHistory.pop_back();
 
-				// Try to move the king to the target position and check if it's still in check
-				king = getKing(opp_color, dum_king_row, dum_king_col);
-				std::shared_ptr<Piece> tmp_piece = replace(dum_king_row, dum_king_col, row, col);
-				bool still_in_check = isKingInCheck(opp_color);
+	m_sideToMove = oppositeColor(m_sideToMove);
+	m_epSquare = state.epSquare;
+	m_halfmoveClock = state.halfmoveClock;
+	m_checkers = state.checkers;
+	m_key = state.key;
+}
 
-				// Undo the move
-				restore(dum_king_row, dum_king_col, row, col, tmp_piece);
+// Anything besides the king and pawns, without which passing is often the best
+// move (zugzwang)
+bool Board::hasNonPawnMaterial(PieceColor color) const
+{
+	return (pieces(color) & ~pieces(PieceType::Pawn) & ~pieces(PieceType::King)) != 0;
+}
 
-				if (!still_in_check) {
-					return false; // King has at least one legal move to escape check
-				}
+// Whether the position occurred before. Only positions since the last capture or
+// pawn move can match, and only every other ply, with the same side to move. An
+// occurrence within the last ply plies, inside the search, is enough: the side
+// that could avoid it would have. Before that the position must have occurred
+// twice, as for the threefold repetition rule when ply is 0.
+bool Board::isRepetition(int ply) const
+{
+	int size = static_cast<int>(m_stateHistory.size());
+	int end = std::min(m_halfmoveClock, size);
+	bool seen = false;
+	for (int i = 4; i <= end; i += 2) {
+		if (m_stateHistory[size - i].key == m_key) {
+			if (i < ply || seen) {
+				return true;
 			}
+			seen = true;
 		}
 	}
+	return false;
+}
 
-	// Check if any piece can block the check or capture the attacking piece
-	for (int row = 0; row < ROWS; ++row) {
-		for (int col = 0; col < COLS; ++col) {
-			if (row == king_row && col == king_col) continue;
-			std::shared_ptr<Piece> piece = getPiece(row, col);
-			if (!piece) continue;
-
-			if (piece->getColor() == opp_color) {
-				// Check all possible moves for this piece
-				for (int target_row = 0; target_row < ROWS; ++target_row) {
-					for (int target_col = 0; target_col < COLS; ++target_col) {
-						if (piece->isValidMove(row, col, target_row, target_col)) {
-							std::shared_ptr<Piece> tmp_piece = replace(row, col, target_row, target_col);
-							bool still_in_check = isKingInCheck(opp_color);
-
-							// Undo the move
-							restore(row, col, target_row, target_col, tmp_piece);
-
-							if (!still_in_check) {
-								return false; // There is a piece that can block the check or capture the attacker
-							}
-						}
-					}
-				}
+// Material with which neither side can ever mate: bare kings with at most one
+// minor piece, or bishops alone that all stand on squares of one color
+bool Board::isInsufficientMaterial() const
+{
+	constexpr Bitboard DARK_SQUARES_BB = 0xAA55AA55AA55AA55ULL;
+
+	if (pieces(PieceType::Pawn) | pieces(PieceType::Rook) | pieces(PieceType::Queen)) {
+		return false;
+	}
+	Bitboard bishops = pieces(PieceType::Bishop);
+	if (popCount(bishops | pieces(PieceType::Knight)) <= 1) {
+		return true;
+	}
+	return !pieces(PieceType::Knight) && (!(bishops & DARK_SQUARES_BB) || !(bishops & ~DARK_SQUARES_BB));
+}
+
+// Any draw the rules recognize without a move being played, for the search ply
+// plies below its root. Checkmate on the hundredth ply takes precedence over the
+// fifty-move rule.
+bool Board::isDraw(int ply) const
+{
+	if (m_halfmoveClock >= 100 && (!inCheck() || !getLegalMoves().empty())) {
+		return true;
+	}
+	return isInsufficientMaterial() || isRepetition(ply);
+}
+
+void Board::addCastlingMoves(PieceColor color, Bitboard& targets) const
+{
+	int row = (color == PieceColor::White) ? 0 : 7;
+	int king_sq = makeSquare(row, 4);
+	if (!(pieces(color, PieceType::King) & squareBB(king_sq)) || isSquareAttacked(row, 4, color)) {
+		return;
+	}
+
+	bool sides[] = { false, true };
+	for (bool king_side : sides) {
+		int rook_col = king_side ? 7 : 0;
+		int direction = king_side ? 1 : -1;
+		if (!(m_castlingRights & castlingRight(color, king_side))
+			|| !(pieces(color, PieceType::Rook) & squareBB(makeSquare(row, rook_col)))) {
+			continue;
+		}
+
+		// The squares between king and rook must be empty, and the king may not cross an attacked square
+		bool allowed = true;
+		for (int col = 4 + direction; col != rook_col; col += direction) {
+			if (occupied() & squareBB(makeSquare(row, col))) {
+				allowed = false;
+			}
+		}
+		for (int col = 4 + direction; allowed && col != 4 + 3 * direction; col += direction) {
+			if (isSquareAttacked(row, col, color)) {
+				allowed = false;
 			}
 		}
+
+		if (allowed) {
+			targets |= squareBB(makeSquare(row, 4 + 2 * direction));
+		}
 	}
+}
 
-	// If the king has no legal moves to escape check, it's checkmate
-	return true;
+Bitboard Board::computeCheckers() const
+{
+	Bitboard king = pieces(m_sideToMove, PieceType::King);
+	if (!king) {
+		return 0;
+	}
+	return attackersTo(lsb(king), occupied()) & pieces(oppositeColor(m_sideToMove));
+}
+
+Bitboard Board::pinnedPieces(PieceColor color) const
+{
+	Bitboard king = pieces(color, PieceType::King);
+	if (!king) {
+		return 0;
+	}
+
+	// Enemy sliders that would hit the king on an empty board pin a piece of ours
+	// when it is the only one standing in between
+	int king_sq = lsb(king);
+	PieceColor them = oppositeColor(color);
+	Bitboard queens = pieces(them, PieceType::Queen);
+	Bitboard snipers = (rookAttacks(king_sq, 0) & (pieces(them, PieceType::Rook) | queens))
+		| (bishopAttacks(king_sq, 0) & (pieces(them, PieceType::Bishop) | queens));
+
+	Bitboard pinned = 0;
+	while (snipers) {
+		Bitboard blockers = betweenBB(king_sq, popLsb(snipers)) & occupied();
+		if (popCount(blockers) == 1) {
+			pinned |= blockers & pieces(color);
+		}
+	}
+	return pinned;
+}
 
+bool Board::isLegalEnPassant(int from, int to) const
+{
+	// Both pawns leave their squares at once, which can uncover the king along the
+	// row as well as a diagonal, so recheck the king with the resulting occupancy
+	PieceColor us = m_sideToMove;
+	int king_sq = lsb(pieces(us, PieceType::King));
+	Bitboard captured = squareBB(makeSquare(squareRow(from), squareCol(to)));
+	Bitboard occ = (occupied() ^ squareBB(from) ^ captured) | squareBB(to);
+	return !(attackersTo(king_sq, occ) & pieces(oppositeColor(us)) & ~captured);
 }
-bool Board::isStalemate() 
+
+MoveList Board::generateMoves(bool captures_only) const
 {
-	// Get the position of the current player's king
-	int kingRow = -1, kingCol = -1;
-	std::shared_ptr<King> king = getKing(getOpponentColor(), kingRow, kingCol);
+	MoveList moves;
 
-	// If the king is in check, it's not a stalemate
-	if (isKingInCheck(getCurrentPlayerColor())) {
-		return false;
+	PieceColor us = m_sideToMove;
+	PieceColor them = oppositeColor(us);
+	Bitboard own = pieces(us);
+	Bitboard occ = occupied();
+	Bitboard king = pieces(us, PieceType::King);
+	if (!king) {
+		return moves;
 	}
 
-	// Iterate through all pieces of the current player
-	for (int row = 0; row < ROWS; ++row) {
-		for (int col = 0; col < COLS; ++col) {
-			std::shared_ptr<Piece> piece = getPiece(row, col);
-			if (piece && piece->getColor() == getCurrentPlayerColor()) {
-				// Check all possible moves for this piece
-				for (int destRow = 0; destRow < ROWS; ++destRow) {
-					for (int destCol = 0; destCol < COLS; ++destCol) {
-						if (piece->isValidMove(row, col, destRow, destCol)) {
-							// Simulate the move
-							std::shared_ptr<Piece> tmpPiece = replace(row, col, destRow, destCol);
-							bool stillInCheck = isKingInCheck(getCurrentPlayerColor());
-							restore(row, col, destRow, destCol, tmpPiece);
-
-							// If the move does not leave the king in check, it's not a stalemate
-							if (!stillInCheck) {
-								return false;
-							}
-						}
+	int king_sq = lsb(king);
+	int direction = (us == PieceColor::White) ? 1 : -1;
+	int start_row = (us == PieceColor::White) ? 1 : 6;
+	Bitboard in_check = checkers();
+	Bitboard pinned = pinnedPieces(us);
+
+	// Out of check, the other pieces must capture the checker or block its line.
+	// Against a double check only the king can move.
+	Bitboard check_mask = ~Bitboard(0);
+	Bitboard from_set = own;
+	if (in_check) {
+		check_mask = betweenBB(king_sq, lsb(in_check)) | in_check;
+		if (popCount(in_check) > 1) {
+			from_set = king;
+		}
+	}
+	Bitboard target_mask = ~own & check_mask & (captures_only ? pieces(them) : ~Bitboard(0));
+
+	// Walk our pieces and their targets in ascending square order, which matches
+	// the row by row scan of the board
+	while (from_set) {
+		int from = popLsb(from_set);
+		PieceType type = pieceTypeAt(from);
+		Bitboard targets = 0;
+
+		switch (type) {
+		case PieceType::Pawn: {
+			// Promotions change the material like captures do, so pushes to the last
+			// row are kept when only captures are wanted
+			int one_step = from + 8 * direction;
+			Bitboard pushes = 0;
+			if (one_step >= 0 && one_step < SQUARE_NB && !(occ & squareBB(one_step))) {
+				pushes |= squareBB(one_step);
+				int two_step = one_step + 8 * direction;
+				if (squareRow(from) == start_row && !(occ & squareBB(two_step))) {
+					pushes |= squareBB(two_step);
+				}
+			}
+			if (captures_only) {
+				pushes &= ROW_1_BB | ROW_8_BB;
+			}
+			targets = (pawnAttacks(us, from) & pieces(them) & check_mask) | (pushes & check_mask);
+
+			// En passant gets its own test, the captured pawn is not on the target square
+			if (m_epSquare != NO_SQUARE && (pawnAttacks(us, from) & squareBB(m_epSquare)) && isLegalEnPassant(from, m_epSquare)) {
+				targets |= squareBB(m_epSquare);
+			}
+			break;
+		}
+		case PieceType::Knight:
+			targets = knightAttacks(from) & target_mask;
+			break;
+		case PieceType::Bishop:
+			targets = bishopAttacks(from, occ) & target_mask;
+			break;
+		case PieceType::Rook:
+			targets = rookAttacks(from, occ) & target_mask;
+			break;
+		case PieceType::Queen:
+			targets = (bishopAttacks(from, occ) | rookAttacks(from, occ)) & target_mask;
+			break;
+		case PieceType::King: {
+			// The king may not stay on the line of a slider it is moving away from
+			Bitboard steps = kingAttacks(from) & ~own & (captures_only ? pieces(them) : ~Bitboard(0));
+			while (steps) {
+				int to = popLsb(steps);
+				if (!(attackersTo(to, occ ^ king) & pieces(them))) {
+					targets |= squareBB(to);
+				}
+			}
+			if (!in_check && !captures_only) {
+				addCastlingMoves(us, targets);
+			}
+			break;
+		}
+		default:
+			break;
+		}
+
+		// A pinned piece can only move along the line between its king and the pinner
+		if (pinned & squareBB(from)) {
+			targets &= lineBB(king_sq, from);
+		}
+
+		while (targets) {
+			int to = popLsb(targets);
+
+			if (type == PieceType::Pawn && (squareRow(to) == 0 || squareRow(to) == 7)) {
+				// Only the queen is worth trying when looking at captures alone
+				static const PieceType promotions[] = { PieceType::Queen, PieceType::Rook, PieceType::Bishop, PieceType::Knight };
+				for (PieceType promotion : promotions) {
+					moves.push_back(Move(from, to, MoveFlag::Promotion, promotion));
+					if (captures_only) {
+						break;
 					}
 				}
+			} else if (type == PieceType::Pawn && to == m_epSquare) {
+				moves.push_back(Move(from, to, MoveFlag::EnPassant));
+			} else if (type == PieceType::King && std::abs(to - from) == 2) {
+				moves.push_back(Move(from, to, MoveFlag::Castling));
+			} else {
+				moves.push_back(Move(from, to));
 			}
 		}
 	}
 
-	// If no legal moves are found, it's a stalemate
-	return true;
+	return moves;
 }
 
-void Board::performEnPassant(int src_row, int src_col, int trg_row, int trg_col) 
+int Board::staticExchange(const Move& move) const
 {
-	auto pawn = getPiece(src_row, src_col);
-	int direction = (pawn->getColor() == PieceColor::White) ? 1 : -1;
+	// Play out the captures on the target square, each side always taking back with
+	// its least valuable attacker and stopping once that would lose material.
+	// Pins are not considered.
+	int from = move.from();
+	int to = move.to();
+	PieceType captured = (move.flag() == MoveFlag::EnPassant) ? PieceType::Pawn : pieceTypeAt(to);
+	PieceType attacker = pieceTypeAt(from);
+
+	int gain[32];
+	int depth = 0;
+	gain[0] = Piece::getValue(captured);
+
+	Bitboard occ = occupied() ^ squareBB(from);
+	if (move.flag() == MoveFlag::EnPassant) {
+		occ ^= squareBB(makeSquare(squareRow(from), squareCol(to)));
+	}
+
+	Bitboard diagonal = pieces(PieceType::Bishop) | pieces(PieceType::Queen);
+	Bitboard straight = pieces(PieceType::Rook) | pieces(PieceType::Queen);
+	Bitboard attackers = attackersTo(to, occ) & occ;
+	PieceColor side = oppositeColor(m_sideToMove);
+
+	while (depth < 31) {
+		Bitboard side_attackers = attackers & pieces(side);
+		if (!side_attackers) {
+			break;
+		}
+
+		// The piece standing on the square is what the next capture wins
+		depth++;
+		gain[depth] = Piece::getValue(attacker) - gain[depth - 1];
+		if (std::max(-gain[depth - 1], gain[depth]) < 0) {
+			break;
+		}
+
+		for (int type = static_cast<int>(PieceType::Pawn); type <= static_cast<int>(PieceType::King); ++type) {
+			Bitboard bb = side_attackers & pieces(static_cast<PieceType>(type));
+			if (bb) {
+				attacker = static_cast<PieceType>(type);
+				occ ^= squareBB(lsb(bb));
+				break;
+			}
+		}
 
-	// Capture the target pawn
-	auto target_pawn = getPiece(src_row, trg_col);
-	removePiece(src_row, trg_col);
+		// Sliders lined up behind the piece that just captured join in
+		attackers |= (bishopAttacks(to, occ) & diagonal) | (rookAttacks(to, occ) & straight);
+		attackers &= occ;
+		side = oppositeColor(side);
+	}
 
-	// Move the capturing pawn to the target square
-	replace(src_row, src_col, trg_row, trg_col);
+	// Either side may stop capturing when continuing would cost material
+	while (depth > 0) {
+		gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+		depth--;
+	}
+	return gain[0];
 }
 
-void Board::performCastling(int src_row, int src_col, int trg_row, int trg_col) 
+std::string moveToString(const Move& move)
 {
-	// Perform the castling move
-	int rook_col = (trg_col == 6) ? 7 : 0;
-	int new_rook_col = (trg_col == 6) ? 5 : 3;
-
-	auto king = getPiece(src_row, src_col);
-	auto rook = getPiece(src_row, rook_col);
+	// Coordinate notation, e.g. "e2e4" or "e7e8q"
+	std::string str;
+	str += static_cast<char>('a' + move.srcCol());
+	str += static_cast<char>('1' + move.srcRow());
+	str += static_cast<char>('a' + move.destCol());
+	str += static_cast<char>('1' + move.destRow());
+
+	switch (move.promotion()) {
+	case PieceType::Queen: str += 'q'; break;
+	case PieceType::Rook: str += 'r'; break;
+	case PieceType::Bishop: str += 'b'; break;
+	case PieceType::Knight: str += 'n'; break;
+	default: break;
+	}
 
-	replace(src_row, src_col, trg_row, trg_col); // Move the king
-	replace(src_row, rook_col, trg_row, new_rook_col); // Move the rook
+	return str;
 }
 
-void Board::setMove(const Move &move)
+bool Board::parseMove(const std::string& text, Move& move) const
 {
-	moveHistory.push_back(move);
+	for (const Move& legal : getLegalMoves()) {
+		if (moveToString(legal) == text) {
+			move = legal;
+			return true;
+		}
+	}
+	return false;
 }
 
-static void IncrementTurnCounter()
+// Standard algebraic notation, e.g. "Nbd7", "exd5", "e8=Q+" or "O-O#"
+std::string Board::toSan(const Move& move) const
 {
-	turn_counter++;
+	std::string san;
+	PieceType type = pieceTypeAt(move.from());
+
+	if (move.flag() == MoveFlag::Castling) {
+		san = (move.destCol() == 6) ? "O-O" : "O-O-O";
+	} else {
+		bool capture = (move.flag() == MoveFlag::EnPassant) || (occupied() & squareBB(move.to()));
+		if (type == PieceType::Pawn) {
+			if (capture) {
+				san += static_cast<char>('a' + move.srcCol());
+			}
+		} else {
+			san += "PNBRQK"[static_cast<int>(type) - 1];
+
+			// Name the file, else the rank, else both, when another piece of the
+			// same kind can go to the same square
+			bool ambiguous = false, same_col = false, same_row = false;
+			for (const Move& other : getLegalMoves()) {
+				if (other.to() == move.to() && other.from() != move.from() && pieceTypeAt(other.from()) == type) {
+					ambiguous = true;
+					same_col |= (other.srcCol() == move.srcCol());
+					same_row |= (other.srcRow() == move.srcRow());
+				}
+			}
+			if (ambiguous && (!same_col || same_row)) {
+				san += static_cast<char>('a' + move.srcCol());
+			}
+			if (ambiguous && same_col) {
+				san += static_cast<char>('1' + move.srcRow());
+			}
+		}
+		if (capture) {
+			san += 'x';
+		}
+		san += static_cast<char>('a' + move.destCol());
+		san += static_cast<char>('1' + move.destRow());
+		if (move.flag() == MoveFlag::Promotion) {
+			san += '=';
+			san += "PNBRQK"[static_cast<int>(move.promotion()) - 1];
+		}
+	}
+
+	Board next = *this;
+	next.makeMove(move);
+	if (next.inCheck()) {
+		san += next.getLegalMoves().empty() ? '#' : '+';
+	}
+	return san;
 }
 
-MoveResult Board::evaluateGameState(const Move &move)
+static PieceType sanPieceType(char c)
 {
-	if (isKingInCheck(getCurrentPlayerColor())) {
-		restore(move.src_row, move.src_col, move.dest_row, move.dest_col, move.captured_piece);
-		return MoveResult::KingInCheck;
-	} else if (isCheckmate()) {
-		return MoveResult::Checkmate;
-	} else if (isStalemate()) {
-		return MoveResult::Stalemate;
-	} else if (checkForPromotion(move.dest_row, move.dest_col)) {
-		if (isCheckmate()) {
-			return MoveResult::Checkmate;
-		} else if (isStalemate()) {
-			return MoveResult::Stalemate;
-		}
-	}
-	
-	IncrementTurnCounter();
-	setMove(move);
-	move.src_piece->setMoved(true);
-	return MoveResult::ValidMove;
+	switch (c) {
+	case 'N': return PieceType::Knight;
+	case 'B': return PieceType::Bishop;
+	case 'R': return PieceType::Rook;
+	case 'Q': return PieceType::Queen;
+	case 'K': return PieceType::King;
+	default: return PieceType::Empty;
+	}
 }
 
-MoveResult Board::move(Move &move)
+// Accepts what archives contain besides strict SAN: check and annotation marks,
+// "0-0" castling, promotions without '=' and redundant disambiguation. The text
+// must match exactly one legal move.
+bool Board::parseSan(std::string_view text, Move& move) const
 {
-	move.src_piece = getPiece(move.src_row, move.src_col);
+	while (!text.empty() && (text.back() == '+' || text.back() == '#' || text.back() == '!' || text.back() == '?')) {
+		text.remove_suffix(1);
+	}
+	if (text.size() < 2) {
+		return false;
+	}
 
-	// Check if the player chose a piece
-	if (!move.src_piece) {
-		return MoveResult::InvalidPiece;
+	MoveList legal = getLegalMoves();
+	if (text == "O-O" || text == "0-0" || text == "O-O-O" || text == "0-0-0") {
+		int col = (text.size() == 3) ? 6 : 2;
+		for (const Move& candidate : legal) {
+			if (candidate.flag() == MoveFlag::Castling && candidate.destCol() == col) {
+				move = candidate;
+				return true;
+			}
+		}
+		return false;
 	}
 
-	// Check if the player chose opponent's piece
-	PieceColor opp_color = getOpponentColor();
-	if (move.src_piece->getColor() == opp_color) {
-		return MoveResult::OpponentPiece;
+	PieceType type = sanPieceType(text.front());
+	if (type == PieceType::Empty) {
+		type = PieceType::Pawn;
+	} else {
+		text.remove_prefix(1);
 	}
 
-	// Handle castling move
-	if (move.src_piece->getType() == PieceType::King) {
-		std::shared_ptr<King> king = std::static_pointer_cast<King> (move.src_piece);
-		if (king->canCastle(move.src_row, move.src_col, move.dest_row, move.dest_col)) {
-			performCastling(move.src_row, move.src_col, move.dest_row, move.dest_col);
-			king->setMoved(true);
-			return MoveResult::ValidMove;
+	PieceType promotion = PieceType::Empty;
+	if (type == PieceType::Pawn && sanPieceType(text.back()) != PieceType::Empty) {
+		promotion = sanPieceType(text.back());
+		text.remove_suffix(1);
+		if (!text.empty() && text.back() == '=') {
+			text.remove_suffix(1);
 		}
 	}
 
-	// Handle EnPassant move
-	if (move.src_piece->getType() == PieceType::Pawn) {
-		std::shared_ptr<Pawn> pawn = std::static_pointer_cast<Pawn> (move.src_piece);
-		if (pawn->isEnPassant(move.src_row, move.src_col, move.dest_row, move.dest_col)) {
-			performEnPassant(move.src_row, move.src_col, move.dest_row, move.dest_col);
-			pawn->setMoved(true);
-			return MoveResult::ValidMove;
+	if (text.size() < 2) {
+		return false;
+	}
+	char dest_file = text[text.size() - 2], dest_rank = text[text.size() - 1];
+	if (dest_file < 'a' || dest_file > 'h' || dest_rank < '1' || dest_rank > '8') {
+		return false;
+	}
+	int to = makeSquare(dest_rank - '1', dest_file - 'a');
+	text.remove_suffix(2);
+
+	// What is left is the disambiguation and the capture mark
+	int from_col = -1, from_row = -1;
+	for (char c : text) {
+		if (c >= 'a' && c <= 'h') {
+			from_col = c - 'a';
+		} else if (c >= '1' && c <= '8') {
+			from_row = c - '1';
+		} else if (c != 'x' && c != ':') {
+			return false;
 		}
 	}
 
-	// Check if the player chose a valid move for the corresponding Piece
-	if (!move.src_piece->isValidMove(move.src_row, move.src_col, move.dest_row, move.dest_col)) {
-		return MoveResult::InvalidMove;
+	int matches = 0;
+	for (const Move& candidate : legal) {
+		if (candidate.to() == to && pieceTypeAt(candidate.from()) == type && candidate.promotion() == promotion
+			&& candidate.flag() != MoveFlag::Castling
+			&& (from_col < 0 || candidate.srcCol() == from_col) && (from_row < 0 || candidate.srcRow() == from_row)) {
+			move = candidate;
+			matches++;
+		}
 	}
+	return matches == 1;
+}
 
-	move.captured_piece = replace(move.src_row, move.src_col, move.dest_row, move.dest_col);
-	return MoveResult::ValidMove;
+// Splits off the next space separated field of a FEN, empty when there is none
+static std::string_view nextFenField(std::string_view& fen)
+{
+	size_t start = fen.find_first_not_of(' ');
+	if (start == std::string_view::npos) {
+		fen = {};
+		return {};
+	}
+	size_t end = fen.find(' ', start);
+	std::string_view field = fen.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+	fen.remove_prefix(end == std::string_view::npos ? fen.size() : end);
+	return field;
 }
 
-void Board::makeMove(const Move& move) 
+// Optional counters at the end of a FEN. A missing one keeps value as it is;
+// anything that is not a number is rejected.
+static bool parseFenNumber(std::string_view field, int& value)
 {
-	moveHistory.push_back(move);
-	replace(move.src_row, move.src_col, move.dest_row, move.dest_col);
+	if (field.empty()) {
+		return true;
+	}
+	if (field.size() > 6) {
+		return false;
+	}
+	int parsed = 0;
+	for (char c : field) {
+		if (c < '0' || c > '9') {
+			return false;
+		}
+		parsed = parsed * 10 + (c - '0');
+	}
+	value = parsed;
+	return true;
 }
 
-void Board::undoMove(const Move& move, std::shared_ptr<Piece> capturedPiece) 
+// Piece letters by PieceColor and PieceType
+static constexpr char FEN_PIECES[3][7] = { {}, { ' ', 'P', 'N', 'B', 'R', 'Q', 'K' }, { ' ', 'p', 'n', 'b', 'r', 'q', 'k' } };
+
+// Whether the king of the given color is attacked, for pieces not yet on a board.
+// Follows attackersTo().
+static bool fenKingAttacked(const std::array<Bitboard, 7>& byType, const std::array<Bitboard, 3>& byColor, PieceColor color)
 {
-	restore(move.src_row, move.src_col, move.dest_row, move.dest_col, capturedPiece);
-	moveHistory.pop_back();
+	auto piecesOf = [&](PieceColor c, PieceType t) { return byType[static_cast<int>(t)] & byColor[static_cast<int>(c)]; };
+	PieceColor enemy = oppositeColor(color);
+	int sq = lsb(piecesOf(color, PieceType::King));
+	Bitboard occupied = byColor[static_cast<int>(PieceColor::White)] | byColor[static_cast<int>(PieceColor::Black)];
+	Bitboard queens = piecesOf(enemy, PieceType::Queen);
+	return (pawnAttacks(color, sq) & piecesOf(enemy, PieceType::Pawn))
+		|| (knightAttacks(sq) & piecesOf(enemy, PieceType::Knight))
+		|| (kingAttacks(sq) & piecesOf(enemy, PieceType::King))
+		|| (bishopAttacks(sq, occupied) & (piecesOf(enemy, PieceType::Bishop) | queens))
+		|| (rookAttacks(sq, occupied) & (piecesOf(enemy, PieceType::Rook) | queens));
 }
 
-std::vector<Move> Board::getPossibleMoves(PieceColor color) const 
+// Parses in place without allocating, so batch analysis can load millions of
+// positions a second. The halfmove clock and fullmove number may be left out.
+// Everything is checked before the board changes, so a rejected FEN leaves the
+// position as it was. Rejected are: ranks that do not hold 8 squares, other
+// than 8 ranks, anything but one king per side, pawns on the first or last
+// rank, the side not to move in check, and malformed fields.
+bool Board::loadFen(std::string_view fen)
 {
-	std::vector<Move> moves;
-	for (int row = 0; row < ROWS; ++row) {
-		for (int col = 0; col < COLS; ++col) {
-			auto piece = getPiece(row, col);
+	std::string_view placement = nextFenField(fen);
+	std::string_view side = nextFenField(fen);
+	std::string_view castling = nextFenField(fen);
+	std::string_view ep = nextFenField(fen);
+	std::string_view halfmove = nextFenField(fen);
+	std::string_view fullmove = nextFenField(fen);
+	if (!nextFenField(fen).empty()) {
+		return false;
+	}
 
-			if (piece && piece->getColor() == color) {
-				piece->getValidMoves(row, col, moves);
+	// Piece placement starts at row 7 (rank 8) and column 0 (file a)
+	std::array<Bitboard, 7> byType{};
+	std::array<Bitboard, 3> byColor{};
+	int row = 7, col = 0;
+	for (char c : placement) {
+		if (c == '/') {
+			if (col != 8 || row == 0) {
+				return false;
+			}
+			row--;
+			col = 0;
+		} else if (c >= '1' && c <= '8') {
+			col += c - '0';
+			if (col > 8) {
+				return false;
+			}
+		} else {
+			int color = static_cast<int>((c >= 'a') ? PieceColor::Black : PieceColor::White);
+			int type = 1;
+			while (type < 7 && FEN_PIECES[color][type] != c) {
+				type++;
+			}
+			if (type == 7 || col > 7) {
+				return false;
 			}
+			byType[type] |= squareBB(makeSquare(row, col));
+			byColor[color] |= squareBB(makeSquare(row, col));
+			col++;
 		}
 	}
-	return moves;
-}
-
-int Board::evaluate() const
-{
-	int score = 0;
+	if (row != 0 || col != 8) {
+		return false;
+	}
 
-	// Positional piece-square tables for more strategic play
-	static const int pawnTable[8][8] = {
-		{  0,  0,  0,  0,  0,  0,  0,  0 },
-		{  5, 10, 10, -20, -20, 10, 10,  5 },
-		{  5, -5, -10,  0,  0, -10, -5,  5 },
-		{  0,  0,  0, 20, 20,  0,  0,  0 },
-		{  5,  5, 10, 25, 25, 10,  5,  5 },
-		{ 10, 10, 20, 30, 30, 20, 10, 10 },
-		{ 50, 50, 50, 50, 50, 50, 50, 50 },
-		{  0,  0,  0,  0,  0,  0,  0,  0 }
-	};
+	Bitboard kings = byType[static_cast<int>(PieceType::King)];
+	if (popCount(kings & byColor[static_cast<int>(PieceColor::White)]) != 1
+		|| popCount(kings & byColor[static_cast<int>(PieceColor::Black)]) != 1
+		|| (byType[static_cast<int>(PieceType::Pawn)] & (ROW_1_BB | ROW_8_BB))) {
+		return false;
+	}
 
-	for (int row = 0; row < ROWS; ++row) {
-		for (int col = 0; col < COLS; ++col) {
-			auto piece = getPiece(row, col);
-			if (piece) {
-				int pieceValue = piece->getValue();
-				int positionalBonus = 0;
-
-				// Use piece-square tables for pawns
-				if (piece->getType() == PieceType::Pawn) {
-					if (piece->getColor() == PieceColor::White) {
-						positionalBonus = pawnTable[row][col];
-					}
-					else {
-						positionalBonus = pawnTable[7 - row][col];
-					}
-				}
+	PieceColor sideToMove;
+	if (side == "w") {
+		sideToMove = PieceColor::White;
+	} else if (side == "b") {
+		sideToMove = PieceColor::Black;
+	} else {
+		return false;
+	}
+	if (fenKingAttacked(byType, byColor, oppositeColor(sideToMove))) {
+		return false;
+	}
 
-				// Apply positional bonuses to the score
-				if (piece->getColor() == getCurrentPlayerColor()) {
-					score -= (pieceValue + positionalBonus);
-				}
-				else {
-					score += (pieceValue + positionalBonus);
-				}
+	// Each right once, and only with the king and that rook on their squares
+	uint8_t castlingRights = 0;
+	if (castling != "-") {
+		if (castling.empty()) {
+			return false;
+		}
+		for (char c : castling) {
+			int right, kingSq, rookSq;
+			switch (c) {
+			case 'K': right = CASTLE_WHITE_KINGSIDE; kingSq = makeSquare(0, 4); rookSq = makeSquare(0, 7); break;
+			case 'Q': right = CASTLE_WHITE_QUEENSIDE; kingSq = makeSquare(0, 4); rookSq = makeSquare(0, 0); break;
+			case 'k': right = CASTLE_BLACK_KINGSIDE; kingSq = makeSquare(7, 4); rookSq = makeSquare(7, 7); break;
+			case 'q': right = CASTLE_BLACK_QUEENSIDE; kingSq = makeSquare(7, 4); rookSq = makeSquare(7, 0); break;
+			default: return false;
+			}
+			int color = static_cast<int>((c >= 'a') ? PieceColor::Black : PieceColor::White);
+			Bitboard rooks = byType[static_cast<int>(PieceType::Rook)];
+			if ((castlingRights & right) || !(kings & byColor[color] & squareBB(kingSq)) || !(rooks & byColor[color] & squareBB(rookSq))) {
+				return false;
 			}
+			castlingRights |= right;
 		}
 	}
 
-	return score;
-}
+	// The square behind a pawn that has just moved two squares: empty, on the
+	// right rank and with that pawn in front of it. It is only kept when a
+	// capture there is possible.
+	int epSquare = NO_SQUARE;
+	if (ep != "-") {
+		int epRow = (sideToMove == PieceColor::White) ? 5 : 2;
+		if (ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h' || ep[1] != '1' + epRow) {
+			return false;
+		}
+		int sq = makeSquare(epRow, ep[0] - 'a');
+		int pushed = (sideToMove == PieceColor::White) ? sq - 8 : sq + 8;
+		Bitboard enemyPawns = byType[static_cast<int>(PieceType::Pawn)] & byColor[static_cast<int>(oppositeColor(sideToMove))];
+		if (((byColor[static_cast<int>(PieceColor::White)] | byColor[static_cast<int>(PieceColor::Black)]) & squareBB(sq)) || !(enemyPawns & squareBB(pushed))) {
+			return false;
+		}
+		Bitboard ownPawns = byType[static_cast<int>(PieceType::Pawn)] & byColor[static_cast<int>(sideToMove)];
+		if (pawnAttacks(oppositeColor(sideToMove), sq) & ownPawns) {
+			epSquare = sq;
+		}
+	}
 
+	int halfmoveClock = 0, fullmoveNumber = 1;
+	if (!parseFenNumber(halfmove, halfmoveClock) || !parseFenNumber(fullmove, fullmoveNumber)) {
+		return false;
+	}
 
-int minimax(int depth, int alpha, int beta, bool isMaximizingPlayer) 
-{
-	if (depth == 0 || board->isCheckmate() || board->isStalemate()) {
-		return board->evaluate();
+	// Valid: only now replace the position
+	m_byType.fill(0);
+	m_byColor.fill(0);
+	m_key = 0;
+	m_psqScore = 0;
+	m_pawnKey = 0;
+	m_stateHistory.clear();
+	moveHistory.clear();
+
+	// The accumulator is refreshed once at the end rather than piece by piece
+	const NnueNetwork* network = m_network;
+	m_network = nullptr;
+	for (int color = 1; color <= 2; ++color) {
+		for (int type = 1; type <= 6; ++type) {
+			Bitboard b = byType[type] & byColor[color];
+			while (b) {
+				putPiece(popLsb(b), static_cast<PieceColor>(color), static_cast<PieceType>(type));
+			}
+		}
+	}
+	m_network = network;
+
+	m_sideToMove = sideToMove;
+	m_turnCounter = (m_sideToMove == PieceColor::White) ? 1 : 2;
+	m_halfmoveClock = halfmoveClock;
+	m_fullmoveNumber = std::max(fullmoveNumber, 1);
+	m_castlingRights = castlingRights;
+	m_epSquare = epSquare;
+
+	// The pieces are already in the key
+	m_key ^= Zobrist.castling[m_castlingRights];
+	if (m_epSquare != NO_SQUARE) {
+		m_key ^= Zobrist.enPassant[squareCol(m_epSquare)];
+	}
+	if (m_sideToMove == PieceColor::Black) {
+		m_key ^= Zobrist.side;
 	}
 
-	PieceColor currentTurn = isMaximizingPlayer ? PieceColor::White : PieceColor::Black;
+	m_checkers = computeCheckers();
+	if (m_network) {
+		m_network->refresh(*m_accumulator, *this);
+	}
+	return true;
+}
 
-	if (isMaximizingPlayer) {
-		int maxEval = std::numeric_limits<int>::min();
-		for (const Move& move : board->getPossibleMoves(currentTurn)) {
-			std::shared_ptr<Piece> capturedPiece = board->getPiece(move.dest_row, move.dest_col);
-			board->makeMove(move);
-			int eval = minimax(depth - 1, alpha, beta, false);
-			board->undoMove(move, capturedPiece);
-			maxEval = std::max(maxEval, eval);
-			alpha = std::max(alpha, eval);
-			if (beta <= alpha) {
-				break;
+// Writes the FEN and a terminating zero into out, which must hold FEN_MAX_LENGTH
+// characters, and returns its length. The en passant square is only given when
+// a capture there is possible, as loadFen() keeps it.
+size_t Board::writeFen(char* out) const
+{
+	char* p = out;
+	for (int row = 7; row >= 0; --row) {
+		int empty = 0;
+		for (int col = 0; col < 8; ++col) {
+			int sq = makeSquare(row, col);
+			if (!(occupied() & squareBB(sq))) {
+				empty++;
+				continue;
 			}
-		}
-		return maxEval;
-	} else {
-		int minEval = std::numeric_limits<int>::max();
-		for (const Move& move : board->getPossibleMoves(currentTurn)) {
-			std::shared_ptr<Piece> capturedPiece = board->getPiece(move.dest_row, move.dest_col);
-			board->makeMove(move);
-			int eval = minimax(depth - 1, alpha, beta, true);
-			board->undoMove(move, capturedPiece);
-			minEval = std::min(minEval, eval);
-			beta = std::min(beta, eval);
-			if (beta <= alpha) {
-				break;
+			if (empty) {
+				*p++ = static_cast<char>('0' + empty);
+				empty = 0;
 			}
+			*p++ = FEN_PIECES[static_cast<int>(colorAt(sq))][static_cast<int>(pieceTypeAt(sq))];
+		}
+		if (empty) {
+			*p++ = static_cast<char>('0' + empty);
+		}
+		if (row) {
+			*p++ = '/';
 		}
-		return minEval;
 	}
-}
 
-Move findBestMove(int depth) 
-{
-	int bestValue = std::numeric_limits<int>::max();
-	Move bestMove {-1, -1, -1, -1};
-	std::vector<Move> moves = board->getPossibleMoves(getCurrentPlayerColor());
+	*p++ = ' ';
+	*p++ = (m_sideToMove == PieceColor::White) ? 'w' : 'b';
+
+	*p++ = ' ';
+	if (m_castlingRights & CASTLE_WHITE_KINGSIDE) *p++ = 'K';
+	if (m_castlingRights & CASTLE_WHITE_QUEENSIDE) *p++ = 'Q';
+	if (m_castlingRights & CASTLE_BLACK_KINGSIDE) *p++ = 'k';
+	if (m_castlingRights & CASTLE_BLACK_QUEENSIDE) *p++ = 'q';
+	if (!m_castlingRights) *p++ = '-';
 
-	for (const Move& move : moves) {
-		std::shared_ptr<Piece> capturedPiece = board->getPiece(move.dest_row, move.dest_col);
+	*p++ = ' ';
+	if (m_epSquare != NO_SQUARE) {
+		*p++ = static_cast<char>('a' + squareCol(m_epSquare));
+		*p++ = static_cast<char>('1' + squareRow(m_epSquare));
+	} else {
+		*p++ = '-';
+	}
 
-		board->makeMove(move);
-		int boardValue = minimax(depth - 1, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), true);
-		board->undoMove(move, capturedPiece);
+	*p++ = ' ';
+	p = std::to_chars(p, out + FEN_MAX_LENGTH, m_halfmoveClock).ptr;
+	*p++ = ' ';
+	p = std::to_chars(p, out + FEN_MAX_LENGTH, m_fullmoveNumber).ptr;
+	*p = '\0';
+	return static_cast<size_t>(p - out);
+}
 
-		if (boardValue < bestValue) {
-			bestValue = boardValue;
-			bestMove = move;
+std::string Board::getFen() const
+{
+	char buffer[FEN_MAX_LENGTH];
+	return std::string(buffer, writeFen(buffer));
+}
+
+// Scores are from White's point of view. The sum, or the network's accumulator,
+// is updated on every piece placed or removed, and the pawn structure comes from
+// the pawn table, so a leaf costs little more than reading them.
+int Board::evaluate() const
+{
+#ifdef OPENCHESS_DEBUG_EVAL
+	if (m_psqScore != computeEvaluation()) {
+		std::cerr << "Incremental evaluation " << m_psqScore << " differs from the full recompute " << computeEvaluation() << std::endl;
+		std::abort();
+	}
+	if (m_network) {
+		NnueAccumulator fresh;
+		m_network->refresh(fresh, *this);
+		if (std::memcmp(&fresh, &*m_accumulator, sizeof(fresh)) != 0) {
+			std::cerr << "Incremental network accumulator differs from the full recompute" << std::endl;
+			std::abort();
 		}
 	}
-	return bestMove;
+	if (m_pawnTable && m_pawnTable->probe(*this) != evaluatePawns(*this)) {
+		std::cerr << "Pawn table entry differs from the pawn evaluation" << std::endl;
+		std::abort();
+	}
+#endif
+	if (m_network) {
+		int score = m_network->evaluate(*m_accumulator, m_sideToMove);
+		return (m_sideToMove == PieceColor::White) ? score : -score;
+	}
+	return m_psqScore + (m_pawnTable ? m_pawnTable->probe(*this) : evaluatePawns(*this));
 }
 
+// Switches between the network, when given, and the piece-square evaluation
+void Board::setNetwork(const NnueNetwork* network)
+{
+	m_network = network;
+	if (m_network) {
+		m_accumulator.allocate();
+		m_network->refresh(*m_accumulator, *this);
+	} else {
+		m_accumulator.release();
+	}
+}
 
+// The same sum taken over the whole board
+int Board::computeEvaluation() const
+{
+	int score = 0;
+	Bitboard occupied_bb = occupied();
+	while (occupied_bb) {
+		int sq = popLsb(occupied_bb);
+		score += PieceSquare.values[static_cast<int>(colorAt(sq))][static_cast<int>(pieceTypeAt(sq))][sq];
+	}
+	return score;
+}
@@ -1,8 +1,17 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
+#include "Bitboard.h"
+#include "Move.h"
+#include "Zobrist.h"
+#include "PieceSquare.h"
+#include "Nnue.h"
+#include "PawnTable.h"
 #include "Knight.h"
 #include "Rook.h"
 #include "Pawn.h"
@@ -17,30 +26,88 @@ enum class MoveResult {
     KingInCheck,
     Checkmate,
     Stalemate,
+    Repetition,
+    FiftyMoveRule,
+    InsufficientMaterial,
     ValidMove
 };
 
-struct Move {
-    int src_row, src_col;
-    int dest_row, dest_col;
-	std::shared_ptr<Piece> src_piece, captured_piece;
-};
-
 constexpr int ROWS = 8;
 constexpr int COLS = 8;
 constexpr int SCREEN_WIDTH = 640;
 constexpr int SCREEN_HEIGHT = 640;
 constexpr int TILE_SIZE = SCREEN_WIDTH / COLS;
 
+inline constexpr const char* START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Longest FEN writeFen() produces, with room for the terminating zero
+constexpr size_t FEN_MAX_LENGTH = 128;
+
+constexpr int CASTLE_WHITE_KINGSIDE = 1;
+constexpr int CASTLE_WHITE_QUEENSIDE = 2;
+constexpr int CASTLE_BLACK_KINGSIDE = 4;
+constexpr int CASTLE_BLACK_QUEENSIDE = 8;
+constexpr int CASTLE_ALL = 15;
+
+constexpr int castlingRight(PieceColor color, bool king_side)
+{
+	if (color == PieceColor::White) {
+		return king_side ? CASTLE_WHITE_KINGSIDE : CASTLE_WHITE_QUEENSIDE;
+	}
+	return king_side ? CASTLE_BLACK_KINGSIDE : CASTLE_BLACK_QUEENSIDE;
+}
+
+// Shared immutable piece objects used to describe a square to the UI and the Piece move rules
+const Piece* getPieceInstance(PieceColor color, PieceType type);
+
 class Board
 {
 private:
-	std::array<std::array<std::shared_ptr<Piece>, COLS>, ROWS> m_layout;
+	// Position state: one set per piece type and per color. m_byType[PieceType::Empty]
+	// holds every occupied square.
+	std::array<Bitboard, 7> m_byType{};
+	std::array<Bitboard, 3> m_byColor{};
+	PieceColor m_sideToMove = PieceColor::White;
+	uint8_t m_castlingRights = CASTLE_ALL;
+	int8_t m_epSquare = NO_SQUARE;
+	uint64_t m_key = 0;
+	Bitboard m_checkers = 0; // enemy pieces giving check to the side to move
+	int m_psqScore = 0; // material and piece-square sum, kept up to date by putPiece() and clearSquare()
+	uint64_t m_pawnKey = 0; // Zobrist key of the pawns alone
+	int m_turnCounter = 1; // moves played through the UI, odd while White is to move
+	int m_halfmoveClock = 0; // plies since the last capture or pawn move
+	int m_fullmoveNumber = 1; // starts at 1 and goes up after each Black move
+
+	// What makeMove() cannot recover from the move itself, restored by undoMove().
+	// The saved keys double as the history of earlier positions for repetitions.
+	struct StateInfo {
+		PieceType captured;
+		uint8_t castlingRights;
+		int8_t epSquare;
+		int halfmoveClock;
+		uint64_t key;
+		Bitboard checkers;
+	};
+	std::vector<StateInfo> m_stateHistory;
     std::vector<Move> moveHistory;
 
+	const NnueNetwork* m_network = nullptr; // evaluates instead of m_psqScore when set
+	NnueAccumulatorSlot m_accumulator; // allocated while m_network is set
+	PawnTable* m_pawnTable = nullptr; // caches the pawn structure terms when set
+
     void initializePieceRow(int row, PieceColor color);
     void initializePawnRow(int row, PieceColor color);
     void initializeEmptyRows();
+    void putPiece(int sq, PieceColor color, PieceType type);
+    void clearSquare(int sq);
+    void updateCastlingRights(int src, int dest);
+    void setEnPassantSquare(int sq);
+    uint64_t computeKey() const;
+    Bitboard computeCheckers() const;
+    int computeEvaluation() const;
+    void addCastlingMoves(PieceColor color, Bitboard& targets) const;
+    bool isLegalEnPassant(int from, int to) const;
+    MoveList generateMoves(bool captures_only) const;
 public:
     Board() {
         initializePieceRow(0, PieceColor::White);
@@ -49,32 +116,61 @@ public:
         initializePawnRow(6, PieceColor::Black);
         initializePieceRow(7, PieceColor::Black);
         moveHistory.clear();
+        m_key = computeKey();
     }
 
+    // Checks and plays a move entered by its two squares; generated promotions keep their piece
     MoveResult move(Move &move);
-    std::shared_ptr<Piece> replace(int src_row, int src_col, int trg_row, int trg_col);
-    void restore(int src_row, int src_col, int trg_row, int trg_col, std::shared_ptr<Piece> tmp_piece);
-    std::shared_ptr<Piece> getPiece(int row, int col) const { return m_layout[row][col]; };
-    void setPiece(int row, int col, std::shared_ptr<Piece> piece) { m_layout[row][col] = piece; };
-    bool isCheckmate();
-    std::shared_ptr<King> getKing(PieceColor color, int& king_row, int& king_col) const;
+    const Piece* getPiece(int row, int col) const;
+    void setPiece(int row, int col, const Piece* piece);
+    Bitboard occupied() const { return m_byType[static_cast<int>(PieceType::Empty)]; };
+    Bitboard pieces(PieceColor color) const { return m_byColor[static_cast<int>(color)]; };
+    Bitboard pieces(PieceType type) const { return m_byType[static_cast<int>(type)]; };
+    Bitboard pieces(PieceColor color, PieceType type) const { return pieces(color) & pieces(type); };
+    PieceType pieceTypeAt(int sq) const;
+    PieceColor colorAt(int sq) const;
+    int getCastlingRights() const { return m_castlingRights; };
+    PieceColor getSideToMove() const { return m_sideToMove; };
+    int getTurnCounter() const { return m_turnCounter; };
+    int getEnPassantSquare() const { return m_epSquare; };
+    uint64_t getKey() const { return m_key; };
+    uint64_t getPawnKey() const { return m_pawnKey; };
+    int getHalfmoveClock() const { return m_halfmoveClock; };
+    int getFullmoveNumber() const { return m_fullmoveNumber; };
+    bool loadFen(std::string_view fen);
+    size_t writeFen(char* out) const;
+    std::string getFen() const;
+    Bitboard attackersTo(int sq, Bitboard occupied) const;
+    Bitboard checkers() const { return m_checkers; };
+    bool inCheck() const { return m_checkers != 0; };
+    Bitboard pinnedPieces(PieceColor color) const;
+    bool isCheckmate() const;
+    const King* getKing(PieceColor color, int& king_row, int& king_col) const;
     bool isKingInCheck(PieceColor color) const;
     bool isSquareAttacked(int row, int col, PieceColor color) const;
-    void performCastling(int src_row, int src_col, int trg_row, int trg_col);
-    int checkForPromotion(int dest_row, int dest_col);
-    void performEnPassant(int src_row, int src_col, int trg_row, int trg_col);
     void removePiece(int row, int col);
     Move getLastMove() const;
-    bool isStalemate();
+    bool isStalemate() const;
     void makeMove(const Move& move);
-    void undoMove(const Move& move, std::shared_ptr<Piece> capturedPiece);
-    std::vector<Move> getPossibleMoves(PieceColor color) const;
+    void undoMove(const Move& move);
+    void makeNullMove();
+    void undoNullMove();
+    bool hasNonPawnMaterial(PieceColor color) const;
+    bool isRepetition(int ply) const;
+    bool isInsufficientMaterial() const;
+    bool isDraw(int ply) const;
+    MoveList getLegalMoves() const { return generateMoves(false); };
+    MoveList getLegalCaptures() const { return generateMoves(true); };
+    int staticExchange(const Move& move) const;
+    bool parseMove(const std::string& text, Move& move) const;
+    std::string toSan(const Move& move) const;
+    bool parseSan(std::string_view text, Move& move) const;
+    const std::vector<Move>& getMoveHistory() const { return moveHistory; };
     int evaluate() const;
-    void setMove(const Move &move);
+    void setNetwork(const NnueNetwork* network);
+    const NnueNetwork* getNetwork() const { return m_network; };
+    void setPawnTable(PawnTable* table) { m_pawnTable = table; };
     MoveResult evaluateGameState(const Move& move);
 };
 
-std::shared_ptr<Board> getBoard();
-int getTurnCounter();
-Move findBestMove(int depth);
-PieceColor getCurrentPlayerColor();
+std::string moveToString(const Move& move);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include "Bitboard.h"
+
+enum class MoveFlag : uint16_t { Normal = 0, Promotion, EnPassant, Castling };
+
+// A move packed into 16 bits: from square in bits 0-5, to square in bits 6-11,
+// MoveFlag in bits 12-13 and the promotion piece (Knight to Queen) in bits 14-15.
+// Castling is stored as the two square king move. The zero value, a1a1, means no move.
+class Move
+{
+public:
+	constexpr Move() = default;
+	constexpr explicit Move(uint16_t data) : m_data{ data } {};
+	constexpr Move(int from, int to, MoveFlag flag = MoveFlag::Normal, PieceType promotion = PieceType::Knight)
+		: m_data{ static_cast<uint16_t>(from | (to << 6) | (static_cast<int>(flag) << 12)
+			| ((static_cast<int>(promotion) - static_cast<int>(PieceType::Knight)) << 14)) }
+	{
+	};
+
+	constexpr int from() const { return m_data & 63; };
+	constexpr int to() const { return (m_data >> 6) & 63; };
+	constexpr MoveFlag flag() const { return static_cast<MoveFlag>((m_data >> 12) & 3); };
+	constexpr PieceType promotion() const
+	{
+		return (flag() == MoveFlag::Promotion) ? static_cast<PieceType>((m_data >> 14) + static_cast<int>(PieceType::Knight)) : PieceType::Empty;
+	};
+
+	constexpr int srcRow() const { return squareRow(from()); };
+	constexpr int srcCol() const { return squareCol(from()); };
+	constexpr int destRow() const { return squareRow(to()); };
+	constexpr int destCol() const { return squareCol(to()); };
+
+	constexpr uint16_t raw() const { return m_data; };
+	constexpr bool isValid() const { return m_data != 0; };
+	constexpr bool operator==(const Move& other) const { return m_data == other.m_data; };
+	constexpr bool operator!=(const Move& other) const { return m_data != other.m_data; };
+
+private:
+	uint16_t m_data = 0;
+};
+
+// No position has more than 218 legal moves
+constexpr int MAX_MOVES = 256;
+
+// Fixed capacity move list that lives on the stack, so generating moves at a
+// search node does not touch the heap
+class MoveList
+{
+public:
+	void push_back(Move move) { m_moves[m_size++] = move; };
+	void clear() { m_size = 0; };
+
+	size_t size() const { return m_size; };
+	bool empty() const { return m_size == 0; };
+
+	Move& operator[](size_t i) { return m_moves[i]; };
+	const Move& operator[](size_t i) const { return m_moves[i]; };
+	Move* begin() { return m_moves; };
+	Move* end() { return m_moves + m_size; };
+	const Move* begin() const { return m_moves; };
+	const Move* end() const { return m_moves + m_size; };
+
+private:
+	Move m_moves[MAX_MOVES];
+	size_t m_size = 0;
+};
@@ -0,0 +1,180 @@
+#include <cstring>
+#include <fstream>
+#include "Nnue.h"
+#include "Board.h"
+
+// MSVC never defines __SSE2__, though every x64 target and x86 with /arch:SSE2 has it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OPENCHESS_SSE2
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(OPENCHESS_SSE2)
+#include <emmintrin.h>
+#endif
+
+// Input of a piece as seen by one side. Black's view is flipped vertically so
+// both sides see their own pieces the same way.
+static int featureIndex(PieceColor perspective, PieceColor color, PieceType type, int sq)
+{
+	if (perspective == PieceColor::Black) {
+		sq ^= 56;
+	}
+	int relative = (color == perspective) ? 0 : 1;
+	return (relative * 6 + static_cast<int>(type) - 1) * SQUARE_NB + sq;
+}
+
+// Kernels, picked at compile time like the PEXT lookup in Bitboard.h. The scalar
+// versions are the reference the vector ones must match exactly.
+
+static void addRow(int16_t* acc, const int16_t* row)
+{
+#if defined(__AVX2__)
+	for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+		__m256i* dst = reinterpret_cast<__m256i*>(acc + i);
+		_mm256_store_si256(dst, _mm256_add_epi16(_mm256_load_si256(dst), _mm256_load_si256(reinterpret_cast<const __m256i*>(row + i))));
+	}
+#elif defined(OPENCHESS_SSE2)
+	for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+		__m128i* dst = reinterpret_cast<__m128i*>(acc + i);
+		_mm_store_si128(dst, _mm_add_epi16(_mm_load_si128(dst), _mm_load_si128(reinterpret_cast<const __m128i*>(row + i))));
+	}
+#else
+	for (int i = 0; i < NNUE_HIDDEN; ++i) {
+		acc[i] = static_cast<int16_t>(acc[i] + row[i]);
+	}
+#endif
+}
+
+static void subRow(int16_t* acc, const int16_t* row)
+{
+#if defined(__AVX2__)
+	for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+		__m256i* dst = reinterpret_cast<__m256i*>(acc + i);
+		_mm256_store_si256(dst, _mm256_sub_epi16(_mm256_load_si256(dst), _mm256_load_si256(reinterpret_cast<const __m256i*>(row + i))));
+	}
+#elif defined(OPENCHESS_SSE2)
+	for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+		__m128i* dst = reinterpret_cast<__m128i*>(acc + i);
+		_mm_store_si128(dst, _mm_sub_epi16(_mm_load_si128(dst), _mm_load_si128(reinterpret_cast<const __m128i*>(row + i))));
+	}
+#else
+	for (int i = 0; i < NNUE_HIDDEN; ++i) {
+		acc[i] = static_cast<int16_t>(acc[i] - row[i]);
+	}
+#endif
+}
+
+// Sum of clip(acc[i]) * weights[i] over one half of the hidden layer. The int8
+// weights are widened to int16 so a multiply-add gives exact int32 sums.
+static int32_t dotClipped(const int16_t* acc, const int8_t* weights)
+{
+#if defined(__AVX2__)
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i clip = _mm256_set1_epi16(NNUE_CLIP);
+	__m256i sum = zero;
+	for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+		__m256i x = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+		x = _mm256_min_epi16(_mm256_max_epi16(x, zero), clip);
+		__m256i w = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i)));
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(x, w));
+	}
+	__m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+	return _mm_cvtsi128_si32(half);
+#elif defined(OPENCHESS_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i clip = _mm_set1_epi16(NNUE_CLIP);
+	__m128i sum = zero;
+	for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+		__m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i));
+		x = _mm_min_epi16(_mm_max_epi16(x, zero), clip);
+		// Sign extend eight int8 weights by duplicating each byte and shifting back down
+		__m128i w = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(weights + i));
+		w = _mm_srai_epi16(_mm_unpacklo_epi8(w, w), 8);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(x, w));
+	}
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+	return _mm_cvtsi128_si32(sum);
+#else
+	int32_t sum = 0;
+	for (int i = 0; i < NNUE_HIDDEN; ++i) {
+		int x = acc[i] < 0 ? 0 : (acc[i] > NNUE_CLIP ? NNUE_CLIP : acc[i]);
+		sum += x * weights[i];
+	}
+	return sum;
+#endif
+}
+
+const char* NnueNetwork::kernelName()
+{
+#if defined(__AVX2__)
+	return "AVX2";
+#elif defined(OPENCHESS_SSE2)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+// The file is read as is, so this assumes a little endian machine
+bool NnueNetwork::load(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	char magic[4] = {};
+	uint32_t version = 0, hidden = 0;
+	int32_t divisor = 0;
+
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(&hidden), sizeof(hidden));
+	file.read(reinterpret_cast<char*>(&divisor), sizeof(divisor));
+	if (!file || std::memcmp(magic, "OCNN", 4) != 0 || version != 1 || hidden != NNUE_HIDDEN || divisor <= 0) {
+		return false;
+	}
+
+	file.read(reinterpret_cast<char*>(m_inputWeights), sizeof(m_inputWeights));
+	file.read(reinterpret_cast<char*>(m_inputBiases), sizeof(m_inputBiases));
+	file.read(reinterpret_cast<char*>(m_outputWeights), sizeof(m_outputWeights));
+	file.read(reinterpret_cast<char*>(&m_outputBias), sizeof(m_outputBias));
+	m_outputDivisor = divisor;
+
+	// Nothing may follow, so a file built for another layout is not half read
+	return file && file.peek() == std::ifstream::traits_type::eof();
+}
+
+void NnueNetwork::refresh(NnueAccumulator& acc, const Board& board) const
+{
+	std::memcpy(acc.values[0], m_inputBiases, sizeof(m_inputBiases));
+	std::memcpy(acc.values[1], m_inputBiases, sizeof(m_inputBiases));
+
+	Bitboard occupied = board.occupied();
+	while (occupied) {
+		int sq = popLsb(occupied);
+		addPiece(acc, board.colorAt(sq), board.pieceTypeAt(sq), sq);
+	}
+}
+
+void NnueNetwork::addPiece(NnueAccumulator& acc, PieceColor color, PieceType type, int sq) const
+{
+	addRow(acc.values[0], m_inputWeights[featureIndex(PieceColor::White, color, type, sq)]);
+	addRow(acc.values[1], m_inputWeights[featureIndex(PieceColor::Black, color, type, sq)]);
+}
+
+void NnueNetwork::removePiece(NnueAccumulator& acc, PieceColor color, PieceType type, int sq) const
+{
+	subRow(acc.values[0], m_inputWeights[featureIndex(PieceColor::White, color, type, sq)]);
+	subRow(acc.values[1], m_inputWeights[featureIndex(PieceColor::Black, color, type, sq)]);
+}
+
+int NnueNetwork::evaluate(const NnueAccumulator& acc, PieceColor side_to_move) const
+{
+	int us = (side_to_move == PieceColor::White) ? 0 : 1;
+	int32_t sum = dotClipped(acc.values[us], m_outputWeights)
+		+ dotClipped(acc.values[1 - us], m_outputWeights + NNUE_HIDDEN)
+		+ m_outputBias;
+	return sum / m_outputDivisor;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "Bitboard.h"
+
+class Board;
+
+// Efficiently updatable neural network evaluation, used instead of the piece-square
+// evaluation once a network is loaded.
+//
+// Each side has its own view of the board: 768 inputs, one per color, piece type
+// and square, with Black's view mirrored so that its own pieces always come first
+// and move up the board. Both views share one int16 input layer into a hidden
+// layer of NNUE_HIDDEN neurons, the accumulator, which is kept up to date piece
+// by piece as moves are made and unmade. The side to move's half and then the
+// other half are clipped to [0, NNUE_CLIP] and fed through int8 output weights:
+//
+//   eval = (sum(clip(acc_us) * w_us) + sum(clip(acc_them) * w_them) + bias) / divisor
+//
+// in centipawns for the side to move.
+constexpr int NNUE_INPUTS = 2 * 6 * SQUARE_NB;
+constexpr int NNUE_HIDDEN = 256;
+constexpr int NNUE_CLIP = 127;
+
+// Hidden layer sums for White's view and Black's view
+struct NnueAccumulator {
+	alignas(32) int16_t values[2][NNUE_HIDDEN];
+};
+
+// The accumulator a board carries while it has a network. It is allocated only
+// then, so boards evaluated by the piece-square tables stay small, and copying
+// the board copies it.
+class NnueAccumulatorSlot
+{
+public:
+	NnueAccumulatorSlot() = default;
+	NnueAccumulatorSlot(const NnueAccumulatorSlot& other) { *this = other; };
+	NnueAccumulatorSlot(NnueAccumulatorSlot&&) = default;
+	NnueAccumulatorSlot& operator=(NnueAccumulatorSlot&&) = default;
+	NnueAccumulatorSlot& operator=(const NnueAccumulatorSlot& other)
+	{
+		if (!other.m_acc) {
+			m_acc.reset();
+		} else if (m_acc) {
+			*m_acc = *other.m_acc;
+		} else {
+			m_acc = std::make_unique<NnueAccumulator>(*other.m_acc);
+		}
+		return *this;
+	};
+
+	void allocate()
+	{
+		if (!m_acc) {
+			m_acc = std::make_unique<NnueAccumulator>();
+		}
+	};
+	void release() { m_acc.reset(); };
+	NnueAccumulator& operator*() const { return *m_acc; };
+
+private:
+	std::unique_ptr<NnueAccumulator> m_acc;
+};
+
+// Weights file layout, all little endian:
+//   char[4]  "OCNN"
+//   uint32   version (1)
+//   uint32   hidden size (NNUE_HIDDEN)
+//   int32    output divisor
+//   int16    input weights [NNUE_INPUTS][NNUE_HIDDEN]
+//   int16    input biases [NNUE_HIDDEN]
+//   int8     output weights [2 * NNUE_HIDDEN], the side to move's half first
+//   int32    output bias
+class NnueNetwork
+{
+public:
+	bool load(const std::string& path);
+
+	void refresh(NnueAccumulator& acc, const Board& board) const;
+	void addPiece(NnueAccumulator& acc, PieceColor color, PieceType type, int sq) const;
+	void removePiece(NnueAccumulator& acc, PieceColor color, PieceType type, int sq) const;
+	int evaluate(const NnueAccumulator& acc, PieceColor side_to_move) const;
+
+	// The instruction set the kernels were compiled for
+	static const char* kernelName();
+
+private:
+	alignas(32) int16_t m_inputWeights[NNUE_INPUTS][NNUE_HIDDEN];
+	alignas(32) int16_t m_inputBiases[NNUE_HIDDEN];
+	alignas(32) int8_t m_outputWeights[2 * NNUE_HIDDEN];
+	int32_t m_outputBias = 0;
+	int32_t m_outputDivisor = 1;
+};
@@ -0,0 +1,92 @@
+#include "PawnTable.h"
+#include "Board.h"
+
+constexpr int DOUBLED_PENALTY = 12;  // for each pawn beyond the first on a file
+constexpr int ISOLATED_PENALTY = 15; // no friendly pawn on either neighbouring file
+constexpr int BACKWARD_PENALTY = 10; // left behind its neighbours and unable to advance safely
+constexpr int PASSED_BONUS[8] = { 0, 5, 10, 20, 35, 60, 100, 0 }; // by row, seen from the pawn's side
+
+constexpr Bitboard fileBB(int col) { return FILE_A_BB << col; }
+
+constexpr Bitboard adjacentFilesBB(int col)
+{
+	return shiftBB(fileBB(col), 0, -1) | shiftBB(fileBB(col), 0, 1);
+}
+
+// Every row in front of the given one, as seen by color
+constexpr Bitboard rowsAheadBB(PieceColor color, int row)
+{
+	if (color == PieceColor::White) {
+		return (row < 7) ? ~Bitboard(0) << (8 * (row + 1)) : 0;
+	}
+	return (Bitboard(1) << (8 * row)) - 1;
+}
+
+static int evaluatePawnSide(const Board& board, PieceColor us)
+{
+	PieceColor them = oppositeColor(us);
+	Bitboard ours = board.pieces(us, PieceType::Pawn);
+	Bitboard theirs = board.pieces(them, PieceType::Pawn);
+	int score = 0;
+
+	for (int col = 0; col < 8; ++col) {
+		int count = popCount(ours & fileBB(col));
+		if (count > 1) {
+			score -= DOUBLED_PENALTY * (count - 1);
+		}
+	}
+
+	Bitboard pawns = ours;
+	while (pawns) {
+		int sq = popLsb(pawns);
+		int row = squareRow(sq);
+		int col = squareCol(sq);
+		Bitboard ahead = rowsAheadBB(us, row);
+		Bitboard neighbours = ours & adjacentFilesBB(col);
+
+		if (!(theirs & ahead & (fileBB(col) | adjacentFilesBB(col)))) {
+			score += PASSED_BONUS[(us == PieceColor::White) ? row : 7 - row];
+		}
+
+		if (!neighbours) {
+			score -= ISOLATED_PENALTY;
+		} else if (!(neighbours & ~ahead) && row != 0 && row != 7) {
+			// Every neighbour has moved past it and an enemy pawn guards the square in front
+			int stop = sq + ((us == PieceColor::White) ? 8 : -8);
+			if (pawnAttacks(us, stop) & theirs) {
+				score -= BACKWARD_PENALTY;
+			}
+		}
+	}
+
+	return score;
+}
+
+int evaluatePawns(const Board& board)
+{
+	return evaluatePawnSide(board, PieceColor::White) - evaluatePawnSide(board, PieceColor::Black);
+}
+
+int PawnTable::probe(const Board& board)
+{
+	uint64_t key = board.getPawnKey();
+	Entry& entry = m_entries[key & m_mask];
+	m_probes++;
+	if (entry.key == key) {
+		m_hits++;
+		return entry.score;
+	}
+
+	entry.key = key;
+	entry.score = evaluatePawns(board);
+	return entry.score;
+}
+
+void PawnTable::clear()
+{
+	for (Entry& entry : m_entries) {
+		entry = Entry{};
+	}
+	m_probes = 0;
+	m_hits = 0;
+}
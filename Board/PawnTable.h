@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Board;
+
+// Pawn structure in centipawns from White's point of view: passed, isolated,
+// doubled and backward pawns. It depends on the pawns alone.
+int evaluatePawns(const Board& board);
+
+// Remembers evaluatePawns() by the board's pawn key. The pawns change on few
+// moves, so most of the search tree shares a handful of structures and nearly
+// every lookup hits. Each search thread has its own table.
+class PawnTable
+{
+public:
+	PawnTable(size_t entries = 1 << 14) : m_entries(entries), m_mask(entries - 1) {}; // a power of two
+
+	int probe(const Board& board);
+	void clear();
+
+	uint64_t probes() const { return m_probes; };
+	uint64_t hits() const { return m_hits; };
+
+private:
+	struct Entry {
+		uint64_t key = 0;
+		int score = 0;
+	};
+
+	// The empty table already holds the right score for no pawns at all, whose key is zero
+	std::vector<Entry> m_entries;
+	size_t m_mask;
+	uint64_t m_probes = 0;
+	uint64_t m_hits = 0;
+};
@@ -0,0 +1,362 @@
+#include <algorithm>
+#include "Pgn.h"
+#include "Board.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::string_view PgnGame::tag(std::string_view name) const
+{
+	for (const PgnTag& tag : tags) {
+		if (tag.name == name) {
+			return tag.value;
+		}
+	}
+	return {};
+}
+
+// The line starting at pos, without its line break, and the start of the next one
+static std::string_view nextLine(std::string_view text, size_t& pos)
+{
+	size_t end = text.find('\n', pos);
+	if (end == std::string_view::npos) {
+		end = text.size();
+	}
+	std::string_view line = text.substr(pos, end - pos);
+	pos = std::min(end + 1, text.size());
+	if (!line.empty() && line.back() == '\r') {
+		line.remove_suffix(1);
+	}
+	return line;
+}
+
+static bool isBlank(std::string_view line)
+{
+	return line.find_first_not_of(" \t\r") == std::string_view::npos;
+}
+
+// [Name "Value"]
+static bool parseTag(std::string_view line, PgnTag& tag)
+{
+	size_t name_end = line.find_first_of(" \t", 1);
+	size_t open = line.find('"');
+	size_t close = line.rfind('"');
+	if (name_end == std::string_view::npos || open == std::string_view::npos || close <= open) {
+		return false;
+	}
+	tag.name = line.substr(1, name_end - 1);
+	tag.value = line.substr(open + 1, close - open - 1);
+	return true;
+}
+
+bool PgnReader::next(PgnGame& game)
+{
+	game.tags.clear();
+	game.movetext = {};
+
+	// Tag pairs, skipping blank lines before and between them
+	size_t pos = m_pos;
+	while (pos < m_text.size()) {
+		size_t line_start = pos;
+		std::string_view line = nextLine(m_text, pos);
+		if (isBlank(line)) {
+			continue;
+		}
+		if (line.front() != '[') {
+			pos = line_start;
+			break;
+		}
+		PgnTag tag;
+		if (parseTag(line, tag)) {
+			game.tags.push_back(tag);
+		}
+	}
+
+	// Movetext, up to the next tag section. A '[' inside a comment can only start
+	// a line in unusual files and is taken as the next game.
+	size_t movetext_start = pos, movetext_end = pos;
+	while (pos < m_text.size()) {
+		size_t line_start = pos;
+		std::string_view line = nextLine(m_text, pos);
+		if (!line.empty() && line.front() == '[') {
+			pos = line_start;
+			break;
+		}
+		if (!isBlank(line)) {
+			movetext_end = line_start + line.size();
+		}
+	}
+
+	m_pos = pos;
+	game.movetext = m_text.substr(movetext_start, movetext_end - movetext_start);
+	return !game.tags.empty() || !game.movetext.empty();
+}
+
+// Whether a game begins on the line at line_start: a tag line after movetext,
+// or the first line that is not blank
+static bool startsGame(std::string_view text, size_t line_start)
+{
+	if (text[line_start] != '[') {
+		return false;
+	}
+	size_t end = line_start; // just past the line break of the line before
+	while (end > 0) {
+		size_t begin = (end >= 2) ? text.rfind('\n', end - 2) : std::string_view::npos;
+		begin = (begin == std::string_view::npos) ? 0 : begin + 1;
+		std::string_view line = text.substr(begin, end - 1 - begin);
+		if (!isBlank(line)) {
+			return line.front() != '[';
+		}
+		end = begin;
+	}
+	return true;
+}
+
+std::vector<std::string_view> splitPgn(std::string_view text, int parts)
+{
+	std::vector<std::string_view> pieces;
+	size_t start = 0;
+	for (int i = 1; i < parts; ++i) {
+		// From the first line start at or after an even share of the text
+		size_t pos = std::max(start, text.size() / parts * i);
+		if (pos > 0 && pos < text.size() && text[pos - 1] != '\n') {
+			nextLine(text, pos);
+		}
+		while (pos < text.size() && !startsGame(text, pos)) {
+			nextLine(text, pos);
+		}
+		if (pos > start) {
+			pieces.push_back(text.substr(start, pos - start));
+			start = pos;
+		}
+	}
+	if (start < text.size()) {
+		pieces.push_back(text.substr(start));
+	}
+	return pieces;
+}
+
+// Splits off the next movetext token: a move, move number, result or NAG.
+// Comments and variations are skipped on the way.
+static std::string_view nextToken(std::string_view& text)
+{
+	size_t i = 0;
+	int depth = 0;
+	while (i < text.size()) {
+		char c = text[i];
+		if (c == '{') {
+			size_t close = text.find('}', i);
+			i = (close == std::string_view::npos) ? text.size() : close + 1;
+		} else if (c == ';') {
+			size_t close = text.find('\n', i);
+			i = (close == std::string_view::npos) ? text.size() : close + 1;
+		} else if (c == '(') {
+			depth++;
+			i++;
+		} else if (c == ')') {
+			depth = std::max(0, depth - 1);
+			i++;
+		} else if (depth > 0 || c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+			i++;
+		} else {
+			break;
+		}
+	}
+
+	size_t end = i;
+	while (end < text.size() && std::string_view(" \t\r\n{}();").find(text[end]) == std::string_view::npos) {
+		end++;
+	}
+	std::string_view token = text.substr(i, end - i);
+	text.remove_prefix(end);
+	return token;
+}
+
+bool replayPgn(const PgnGame& game, Board& board, const std::function<void(const Board&, const Move&)>& visit, std::string* error)
+{
+	std::string_view fen = game.tag("FEN");
+	if (!board.loadFen(fen.empty() ? std::string_view(START_FEN) : fen)) {
+		if (error) {
+			*error = "bad FEN " + std::string(fen);
+		}
+		return false;
+	}
+
+	std::string_view text = game.movetext;
+	while (true) {
+		std::string_view token = nextToken(text);
+		if (token.empty()) {
+			return true;
+		}
+
+		// Move numbers may stick to the move, as in "12.e4" or "12...Nf6"
+		size_t digits = token.find_first_not_of("0123456789");
+		if (digits != std::string_view::npos && digits > 0 && token[digits] == '.') {
+			digits = token.find_first_not_of('.', digits);
+			if (digits != std::string_view::npos) {
+				token.remove_prefix(digits);
+			}
+		}
+		// Numeric annotations ($1) and standalone ones (!, ?!, ...) say nothing about the moves
+		if (digits == std::string_view::npos || token.front() == '.' || token.front() == '$'
+			|| token.find_first_not_of("!?") == std::string_view::npos) {
+			continue;
+		}
+		if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") {
+			return true;
+		}
+
+		Move move;
+		if (!board.parseSan(token, move)) {
+			if (error) {
+				*error = "illegal move " + std::string(token);
+			}
+			return false;
+		}
+		if (visit) {
+			visit(board, move);
+		}
+		board.makeMove(move);
+	}
+}
+
+static void appendWrapped(std::string& out, size_t& column, const std::string& word)
+{
+	if (column > 0 && column + 1 + word.size() > 80) {
+		out += '\n';
+		column = 0;
+	} else if (column > 0) {
+		out += ' ';
+		column++;
+	}
+	out += word;
+	column += word.size();
+}
+
+std::string writePgn(const std::vector<std::pair<std::string, std::string>>& tags, const std::string& start_fen,
+	const std::vector<Move>& moves, const std::string& result)
+{
+	std::string out;
+	for (const auto& tag : tags) {
+		out += "[" + tag.first + " \"" + tag.second + "\"]\n";
+	}
+	if (!start_fen.empty()) {
+		out += "[SetUp \"1\"]\n[FEN \"" + start_fen + "\"]\n";
+	}
+	out += '\n';
+
+	Board board;
+	board.loadFen(start_fen.empty() ? START_FEN : start_fen);
+
+	size_t column = 0;
+	bool first = true;
+	for (const Move& move : moves) {
+		bool white = (board.getSideToMove() == PieceColor::White);
+		if (white || first) {
+			appendWrapped(out, column, std::to_string(board.getFullmoveNumber()) + (white ? "." : "..."));
+		}
+		appendWrapped(out, column, board.toSan(move));
+		board.makeMove(move);
+		first = false;
+	}
+	appendWrapped(out, column, result);
+	out += "\n\n";
+	return out;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		return false;
+	}
+	m_file = file;
+	if (size.QuadPart == 0) {
+		return true;
+	}
+
+	m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* data = m_mapping ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!data) {
+		close();
+		return false;
+	}
+	m_data = static_cast<const char*>(data);
+	m_size = static_cast<size_t>(size.QuadPart);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_data) {
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping) {
+		CloseHandle(m_mapping);
+	}
+	if (m_file) {
+		CloseHandle(m_file);
+	}
+	m_data = nullptr;
+	m_size = 0;
+	m_mapping = nullptr;
+	m_file = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		::close(fd);
+		return false;
+	}
+	if (info.st_size == 0) {
+		::close(fd);
+		return true;
+	}
+
+	// The mapping stays valid after the descriptor is closed
+	void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+	madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+	m_data = static_cast<const char*>(data);
+	m_size = static_cast<size_t>(info.st_size);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_data) {
+		munmap(const_cast<char*>(m_data), m_size);
+	}
+	m_data = nullptr;
+	m_size = 0;
+}
+
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "Move.h"
+
+class Board;
+
+// Portable Game Notation. The reader never copies: tags and movetext are views
+// into the text it was given, usually a memory mapped file, which must outlive
+// them.
+
+struct PgnTag {
+	std::string_view name;
+	std::string_view value; // between the quotes, escapes left as they are
+};
+
+struct PgnGame {
+	std::vector<PgnTag> tags;
+	std::string_view movetext;
+
+	std::string_view tag(std::string_view name) const;
+};
+
+// Hands out one game after the other. A game is its tag pairs followed by its
+// movetext; the next line starting with '[' after the movetext begins the next.
+class PgnReader
+{
+public:
+	explicit PgnReader(std::string_view text) : m_text(text) {};
+
+	bool next(PgnGame& game);
+
+private:
+	std::string_view m_text;
+	size_t m_pos = 0;
+};
+
+// Cuts the text into about parts pieces, each ending at a game boundary, so that
+// every piece can be read by its own thread
+std::vector<std::string_view> splitPgn(std::string_view text, int parts);
+
+// Plays the movetext on board, which is set up from the FEN tag if there is one
+// and from the start position otherwise. Comments, variations, annotations ($1, !?),
+// move numbers and the result are skipped; every move must be legal SAN. visit,
+// when given, sees each position with the move about to be played from it. On
+// failure, error names the offending token and board holds the position before it.
+bool replayPgn(const PgnGame& game, Board& board, const std::function<void(const Board&, const Move&)>& visit = nullptr,
+	std::string* error = nullptr);
+
+// A whole game: tags in the order given, which should start with the Seven Tag
+// Roster, SetUp and FEN tags unless start_fen is empty for the initial position,
+// then the moves in SAN wrapped at 80 columns and the result
+std::string writePgn(const std::vector<std::pair<std::string, std::string>>& tags, const std::string& start_fen,
+	const std::vector<Move>& moves, const std::string& result);
+
+// Read only view of a whole file, mapped into memory where the system allows
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile() { close(); };
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string& path);
+	void close();
+	std::string_view view() const { return std::string_view(m_data, m_size); };
+
+private:
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#endif
+};
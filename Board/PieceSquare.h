@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Bitboard.h"
+#include "Piece.h"
+
+// Material plus a positional bonus for every piece on every square, in
+// centipawns from White's point of view. Black's entries are White's mirrored
+// and negated, so the evaluation is the plain sum over all pieces on the board.
+struct PieceSquareTables {
+	int values[3][7][SQUARE_NB]; // indexed by PieceColor, PieceType and square
+};
+
+constexpr PieceSquareTables makePieceSquareTables()
+{
+	// Seen from White's side, row 0 being White's back rank
+	constexpr int pawnTable[8][8] = {
+		{  0,  0,  0,  0,  0,  0,  0,  0 },
+		{  5, 10, 10, -20, -20, 10, 10,  5 },
+		{  5, -5, -10,  0,  0, -10, -5,  5 },
+		{  0,  0,  0, 20, 20,  0,  0,  0 },
+		{  5,  5, 10, 25, 25, 10,  5,  5 },
+		{ 10, 10, 20, 30, 30, 20, 10, 10 },
+		{ 50, 50, 50, 50, 50, 50, 50, 50 },
+		{  0,  0,  0,  0,  0,  0,  0,  0 }
+	};
+
+	PieceSquareTables tables{};
+	for (int type = 1; type < 7; ++type) {
+		for (int sq = 0; sq < SQUARE_NB; ++sq) {
+			int white = Piece::getValue(static_cast<PieceType>(type));
+			int black = white;
+			if (type == static_cast<int>(PieceType::Pawn)) {
+				white += pawnTable[squareRow(sq)][squareCol(sq)];
+				black += pawnTable[7 - squareRow(sq)][squareCol(sq)];
+			}
+			tables.values[static_cast<int>(PieceColor::White)][type][sq] = white;
+			tables.values[static_cast<int>(PieceColor::Black)][type][sq] = -black;
+		}
+	}
+	return tables;
+}
+
+inline constexpr PieceSquareTables PieceSquare = makePieceSquareTables();
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include "Bitboard.h"
+
+struct ZobristKeys {
+	uint64_t pieces[3][7][SQUARE_NB]; // indexed by PieceColor, PieceType and square
+	uint64_t castling[16];            // indexed by the castling rights mask
+	uint64_t enPassant[8];            // indexed by the column of the en passant square
+	uint64_t side;                    // toggled while Black is to move
+};
+
+constexpr ZobristKeys makeZobristKeys()
+{
+	ZobristKeys keys{};
+	uint64_t seed = 1070372;
+
+	// xorshift64* with a fixed seed, so keys are the same in every build
+	auto next = [&seed]() {
+		seed ^= seed >> 12;
+		seed ^= seed << 25;
+		seed ^= seed >> 27;
+		return seed * 2685821657736338717ULL;
+	};
+
+	for (int color = 1; color < 3; ++color) {
+		for (int type = 1; type < 7; ++type) {
+			for (int sq = 0; sq < SQUARE_NB; ++sq) {
+				keys.pieces[color][type][sq] = next();
+			}
+		}
+	}
+
+	// No rights hashes to zero so that positions without castling skip the update
+	for (int rights = 1; rights < 16; ++rights) {
+		keys.castling[rights] = next();
+	}
+
+	for (int col = 0; col < 8; ++col) {
+		keys.enPassant[col] = next();
+	}
+
+	keys.side = next();
+	return keys;
+}
+
+inline constexpr ZobristKeys Zobrist = makeZobristKeys();
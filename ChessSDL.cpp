@@ -9,11 +9,52 @@
 #include <vector>
 #include <memory>
 #include <chrono>
+#include <ctime>
+#include <fstream>
+#include <algorithm>
 
 #include "ChessSDL.h"
 #include "Board.h"
+#include "Pgn.h"
+#include "Search.h"
+#include "SpscQueue.h"
+
+// The web build has no threads unless it is compiled with -pthread. There the AI
+// searches within the frame, blocking it for the move time, and does not ponder.
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define OPENCHESS_NO_THREADS
+#endif
 
-constexpr int depth = 4;
+// The game on screen and the engine playing Black
+static Board board;
+static Search search;
+
+// Wall-clock budget for each AI move; the search deepens until it runs out
+static int aiMoveTimeMs = 1000;
+
+// While the human thinks, the engine searches the position after the reply it
+// expects, the second move of its last principal variation
+static bool pondering = false;
+static Move ponderMove;
+
+// One completed iteration as the search thread hands it over. Fixed size, so
+// pushing it copies a few hundred bytes and never allocates.
+struct SearchProgress {
+    int depth = 0;
+    int score = 0;
+    uint64_t nodes = 0;
+    int64_t timeMs = 0;
+    Move pv[MAX_SEARCH_DEPTH];
+    int pvLength = 0;          // the log shows at most MAX_SEARCH_DEPTH moves
+};
+
+// The AI's turn runs on the search thread; progress comes back through a lock-free queue
+static bool aiThinking = false;
+static std::chrono::steady_clock::time_point aiStart;
+static SpscQueue<SearchProgress, 64> searchProgress;
+#ifdef OPENCHESS_NO_THREADS
+static Move aiResult;
+#endif
 
 static std::map<std::string, SDL_Texture*> textures;
 static SDL_Renderer* renderer;
@@ -21,11 +62,88 @@ static SDL_Window* window;
 
 static bool QUIT = false;
 
+// Where the game is written, when it ends or on the S key
+static std::string pgnPath = "OpenChess.pgn";
+
 bool ChessSDL_NeedToQuit()
 {
     return QUIT;
 }
 
+void ChessSDL_SetMoveTime(int ms)
+{
+    aiMoveTimeMs = ms;
+}
+
+void ChessSDL_SetHashSize(int mb)
+{
+    search.setHashSize(mb);
+}
+
+void ChessSDL_SetSearchThreads(int threads)
+{
+#ifdef OPENCHESS_NO_THREADS
+    threads = 1;
+#endif
+    search.setThreads(threads);
+}
+
+static void ChessSDL_InitSearch()
+{
+    // A full queue drops the update; only the UI's log misses it
+    search.setInfoCallback([](const SearchInfo& info) {
+        SearchProgress progress;
+        progress.depth = info.depth;
+        progress.score = info.score;
+        progress.nodes = info.nodes;
+        progress.timeMs = info.timeMs;
+        progress.pvLength = static_cast<int>(std::min<size_t>(info.pv.size(), MAX_SEARCH_DEPTH));
+        std::copy(info.pv.begin(), info.pv.begin() + progress.pvLength, progress.pv);
+        searchProgress.push(progress);
+    });
+}
+
+void ChessSDL_SetPgnFile(const char* path)
+{
+    pgnPath = path;
+}
+
+// Writes the game so far over the PGN file, with result "*" while it goes on
+static void ChessSDL_SaveGame(const std::string& result)
+{
+    char date[16] = "????.??.??";
+    std::time_t now = std::time(nullptr);
+    if (const std::tm* local = std::localtime(&now)) {
+        std::strftime(date, sizeof(date), "%Y.%m.%d", local);
+    }
+
+    std::vector<std::pair<std::string, std::string>> tags = {
+        { "Event", "OpenChess game" }, { "Site", "?" }, { "Date", date }, { "Round", "-" },
+        { "White", "Player" }, { "Black", "OpenChess" }, { "Result", result }
+    };
+
+    std::ofstream file(pgnPath, std::ios::binary);
+    file << writePgn(tags, "", board.getMoveHistory(), result);
+    if (file) {
+        std::cout << "Game saved to " << pgnPath << std::endl;
+    } else {
+        std::cerr << "Cannot write " << pgnPath << std::endl;
+    }
+}
+
+bool ChessSDL_LoadNetwork(const char* path)
+{
+    static std::unique_ptr<NnueNetwork> network;
+    network = std::make_unique<NnueNetwork>();
+    if (!network->load(path)) {
+        network.reset();
+        search.setNetwork(nullptr);
+        return false;
+    }
+    search.setNetwork(network.get());
+    return true;
+}
+
 static SDL_Texture* getTexture(std::string imagePath)
 {
     return textures[imagePath];
@@ -36,11 +154,6 @@ static SDL_Renderer* getRenderer()
     return renderer;
 }
 
-static SDL_Window* getWindow()
-{
-    return window;
-}
-
 static int init_SDL()
 {
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
@@ -124,6 +237,8 @@ static bool loadMedia(SDL_Renderer* renderer) {
 
 void ChessSDL_Close() 
 {
+    search.stop();
+    search.wait();
     for (auto& pair : textures) {
         SDL_DestroyTexture(pair.second);
     }
@@ -134,8 +249,7 @@ void ChessSDL_Close()
 
 static void ChessSDL_RenderPiece(int row, int col)
 {
-	std::shared_ptr<Board> board = getBoard();
-	std::shared_ptr<Piece> piece = board->getPiece(row, col);
+	const Piece* piece = board.getPiece(row, col);
 
     	if (piece) {
 		std::string imagePath;
@@ -211,13 +325,12 @@ static void ChessSDL_HighlightLastMove()
     ChessSDL_RenderChessBoard();
 
     SDL_Renderer* renderer = getRenderer();
-    std::shared_ptr<Board> board = getBoard();
-    Move move = board->getLastMove();
+    Move move = board.getLastMove();
 
-    if (move.src_col == -1) return;
+    if (!move.isValid()) return;
 
-    ChessSDL_HighlightSelectedTile(renderer, move.src_row, move.src_col, false);
-    ChessSDL_HighlightSelectedTile(renderer, move.dest_row, move.dest_col, false);
+    ChessSDL_HighlightSelectedTile(renderer, move.srcRow(), move.srcCol(), false);
+    ChessSDL_HighlightSelectedTile(renderer, move.destRow(), move.destCol(), false);
     SDL_RenderPresent(renderer);
 }
 
@@ -247,6 +360,7 @@ int ChessSDL_MakePreparations()
         return 1;
     }
 
+    ChessSDL_InitSearch();
     ChessSDL_RenderChessBoard();
 
     return 0;
@@ -254,7 +368,7 @@ int ChessSDL_MakePreparations()
 
 static void showCheckmateMessage()
 {
-	std::string winner = (getTurnCounter() % 2 != 0) ? "Player1 (White)" : "Player2 (Black)";
+	std::string winner = (board.getTurnCounter() % 2 != 0) ? "Player1 (White)" : "Player2 (Black)";
 	std::string message = "Checkmate! " + winner + " has won the game!";
 	SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION, "Game Over", message.c_str(), window);
 }
@@ -265,6 +379,12 @@ static void showStalemateMessage()
 	SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION, "Game Over", message.c_str(), window);
 }
 
+static void showDrawMessage(const std::string& reason)
+{
+	std::string message = "Draw by " + reason + "! Game has ended in draw!";
+	SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION, "Game Over", message.c_str(), window);
+}
+
 static void showOpponentPieceMessage()
 {
 	std::string message = "You can't move an opponent's piece!";
@@ -304,6 +424,15 @@ static void ChessSDL_ShowMoveMessage(MoveResult res)
 	case MoveResult::Stalemate:
 		showStalemateMessage();
 		break;
+	case MoveResult::Repetition:
+		showDrawMessage("threefold repetition");
+		break;
+	case MoveResult::FiftyMoveRule:
+		showDrawMessage("the fifty-move rule");
+		break;
+	case MoveResult::InsufficientMaterial:
+		showDrawMessage("insufficient material");
+		break;
 	case MoveResult::ValidMove:
 		break;
 	default:
@@ -316,9 +445,15 @@ static bool ChessSDL_HandleMoveResult(const MoveResult& res, const Move& move)
     bool quit = false;
 
     if (res == MoveResult::InvalidMove || res == MoveResult::KingInCheck) {
-        ChessSDL_HighlightSelection(move.src_row, move.src_col, true);
-    } else if (res == MoveResult::Checkmate || res == MoveResult::Stalemate) {
+        ChessSDL_HighlightSelection(move.srcRow(), move.srcCol(), true);
+    } else if (res == MoveResult::Checkmate) {
 	ChessSDL_HighlightLastMove();
+	ChessSDL_SaveGame(board.getSideToMove() == PieceColor::White ? "0-1" : "1-0");
+	quit = true;
+    } else if (res == MoveResult::Stalemate || res == MoveResult::Repetition
+        || res == MoveResult::FiftyMoveRule || res == MoveResult::InsufficientMaterial) {
+	ChessSDL_HighlightLastMove();
+	ChessSDL_SaveGame("1/2-1/2");
 	quit = true;
     } else if (res == MoveResult::ValidMove) {
 	ChessSDL_HighlightLastMove();
@@ -330,11 +465,10 @@ static bool ChessSDL_HandleMoveResult(const MoveResult& res, const Move& move)
 
 static bool ChessSDL_MakeTheMove(Move &move)
 {
-    std::shared_ptr<Board> board = getBoard();
-    MoveResult res = board->move(move);
+    MoveResult res = board.move(move);
 
     if (res == MoveResult::ValidMove) {
-	res = board->evaluateGameState(move);
+	res = board.evaluateGameState(move);
     }
 
     return ChessSDL_HandleMoveResult(res, move);
@@ -342,14 +476,11 @@ static bool ChessSDL_MakeTheMove(Move &move)
 
 static int handleFirstClick(Move &move, int row, int col, bool &isPieceSelected)
 {
-	std::shared_ptr<Board> board = getBoard();
-
 	if (!isPieceSelected) {
-		auto selectedPiece = board->getPiece(row, col);
-		if (selectedPiece && selectedPiece->getColor() == getCurrentPlayerColor()) {
+		auto selectedPiece = board.getPiece(row, col);
+		if (selectedPiece && selectedPiece->getColor() == board.getSideToMove()) {
             isPieceSelected = true;
-            move.src_row = row;
-            move.src_col = col;
+            move = Move(makeSquare(row, col), move.to());
 			ChessSDL_HighlightSelection(row, col, false);
 			return 1;
 		}
@@ -361,46 +492,152 @@ static int handleSecondClick(Move &move, int row, int col, bool &isPieceSelected
 {
     if (isPieceSelected) {
 	    isPieceSelected = false;
-        move.dest_row = row;
-        move.dest_col = col;
+        move = Move(move.from(), makeSquare(row, col));
         return 1;
     }
     return 0;
 }
 
-void ChessSDL_GameLoopIteration() 
+static void startPondering()
 {
-    SDL_Event e;
-    static bool isPieceSelected = false;
-    static Move move{ 0 };
+#ifndef OPENCHESS_NO_THREADS
+    const std::vector<Move>& pv = search.getLastStats().pv;
+    if (pv.size() < 2) {
+        return;
+    }
 
-	if (getTurnCounter() % 2 == 0 && !QUIT) {
-        auto start = std::chrono::high_resolution_clock::now();
-		Move aiMove = findBestMove(depth);
-        auto end = std::chrono::high_resolution_clock::now();
+    ponderMove = pv[1];
+    Board next = board;
+    next.makeMove(ponderMove);
 
-        std::chrono::duration<double> elapsed = end - start;
-        double calculationTime = elapsed.count();
+    SearchLimits limits;
+    limits.moveTimeMs = aiMoveTimeMs;
+    limits.ponder = true;
+    search.start(next, limits);
+    pondering = true;
+#endif
+}
 
-        if (calculationTime < 0.5) {
-		    SDL_Delay(500);
+// Turns the ponder search into the AI's search when the human played the expected
+// move; it has usually used up its time already. Otherwise the ponder search is
+// thrown away and a new one starts with the table it has filled.
+static void startThinking()
+{
+    aiStart = std::chrono::steady_clock::now();
+    if (pondering) {
+        pondering = false;
+        if (board.getLastMove() == ponderMove) {
+            std::cout << "Ponder hit on " << moveToString(ponderMove) << std::endl;
+            search.ponderHit();
+            aiThinking = true;
+            return;
         }
+        search.stop();
+        search.wait();
+    }
 
-		QUIT = ChessSDL_MakeTheMove(aiMove);
-		if (QUIT) {
+    SearchLimits limits;
+    limits.moveTimeMs = aiMoveTimeMs;
+#ifdef OPENCHESS_NO_THREADS
+    aiResult = search.findBestMove(board, limits);
+#else
+    search.start(board, limits);
+#endif
+    aiThinking = true;
+}
+
+// Plays the AI's move once its search has ended
+static void finishThinking()
+{
+#ifdef OPENCHESS_NO_THREADS
+    Move aiMove = aiResult;
+#else
+    Move aiMove = search.wait();
+#endif
+    aiThinking = false;
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - aiStart;
+    double calculationTime = elapsed.count();
+
+    const SearchStats& stats = search.getLastStats();
+    std::cout << "AI move " << moveToString(aiMove) << ": depth " << stats.depth << ", " << stats.nodes << " nodes (" << stats.qnodes << " quiescence), "
+        << static_cast<int>(calculationTime * 1000) << " ms, " << stats.nodesPerSecond() << " nps, " << stats.evaluationsPerSecond() << " evals/s, "
+        << stats.threads << " threads, TT hit rate " << static_cast<int>(stats.ttHitRate() * 100) << "%, pawn hit rate "
+        << static_cast<int>(stats.pawnHitRate() * 100) << "%, first move cutoffs "
+        << static_cast<int>(stats.firstMoveCutoffRate() * 100) << "%" << std::endl;
+    std::cout << "  score " << stats.score << ", pv";
+    for (const Move& move : stats.pv) {
+        std::cout << " " << moveToString(move);
+    }
+    std::cout << std::endl;
+
+    QUIT = ChessSDL_MakeTheMove(aiMove);
+    if (QUIT) {
 #ifdef __EMSCRIPTEN__
-			emscripten_cancel_main_loop();
+        emscripten_cancel_main_loop();
 #endif
-		}
-	}
+    } else {
+        startPondering();
+    }
+}
+
+// Prints what the search thread has sent since the last frame
+static void showSearchProgress()
+{
+    SearchProgress info;
+    while (searchProgress.pop(info)) {
+        if (!aiThinking) {
+            continue; // pondering
+        }
+        std::cout << "  depth " << info.depth << ", score " << info.score << ", " << info.nodes << " nodes, " << info.timeMs << " ms, pv";
+        for (int i = 0; i < info.pvLength; ++i) {
+            std::cout << " " << moveToString(info.pv[i]);
+        }
+        std::cout << std::endl;
+    }
+}
+
+// Waits a little for the first event instead of spinning while nothing happens;
+// the browser drives the loop under Emscripten, so there it only polls
+static int nextEvent(SDL_Event& e, bool first)
+{
+#ifdef __EMSCRIPTEN__
+    (void)first;
+    return SDL_PollEvent(&e);
+#else
+    return first ? SDL_WaitEventTimeout(&e, 10) : SDL_PollEvent(&e);
+#endif
+}
+
+void ChessSDL_GameLoopIteration() 
+{
+    SDL_Event e;
+    static bool isPieceSelected = false;
+    static Move move;
+
+    // The search runs on its own thread, so the window keeps handling events while the AI thinks
+    if (board.getTurnCounter() % 2 == 0 && !QUIT) {
+        if (!aiThinking) {
+            startThinking();
+        }
+        showSearchProgress();
+        if (!search.isRunning()) {
+            finishThinking();
+        }
+    } else {
+        showSearchProgress();
+    }
 
-    while (SDL_PollEvent(&e) != 0) {
+    for (bool first = true; nextEvent(e, first) != 0; first = false) {
         if (e.type == SDL_QUIT) {
+            // Stopping takes no longer than the search needs to notice the flag
+            search.stop();
+            search.wait();
             QUIT = true;
 #ifdef __EMSCRIPTEN__
             emscripten_cancel_main_loop();
 #endif
-        } else if (e.type == SDL_MOUSEBUTTONDOWN) {
+        } else if (e.type == SDL_MOUSEBUTTONDOWN && !aiThinking) {
             int x, y;
             SDL_GetMouseState(&x, &y);
             int row = y / TILE_SIZE;
@@ -416,9 +653,14 @@ void ChessSDL_GameLoopIteration()
                     }
                 }
             }
+        } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_s) {
+            ChessSDL_SaveGame("*");
         } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE) {
-            if (isPieceSelected) {
-                ChessSDL_HighlightSelection(move.src_row, move.src_col, true);
+            if (aiThinking) {
+                // Cuts the AI's search short; it plays the best move found so far
+                search.stop();
+            } else if (isPieceSelected) {
+                ChessSDL_HighlightSelection(move.srcRow(), move.srcCol(), true);
                 isPieceSelected = false;
             }
         }
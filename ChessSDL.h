@@ -4,3 +4,8 @@ int ChessSDL_MakePreparations();
 void ChessSDL_Close();
 void ChessSDL_GameLoopIteration();
 bool ChessSDL_NeedToQuit();
+void ChessSDL_SetMoveTime(int ms);
+void ChessSDL_SetHashSize(int mb);
+void ChessSDL_SetSearchThreads(int threads);
+bool ChessSDL_LoadNetwork(const char* path);
+void ChessSDL_SetPgnFile(const char* path);
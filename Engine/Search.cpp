@@ -0,0 +1,755 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <thread>
+#include "Search.h"
+
+#undef min
+#undef max
+
+// Each search thread works on its own copy of the position and only shares the
+// transposition table with the others (Lazy SMP)
+struct Search::Worker {
+	explicit Worker(const Board& root) : board(root) {};
+
+	int id = 0;
+	Board board;
+	SearchStats stats;
+	Move bestMove;
+	int completedDepth = 0;
+	int score = 0;             // of the last completed iteration
+	std::vector<Move> rootPv;  // of the last completed iteration
+
+	// Triangular principal variation table: pv[ply] holds the best line found from
+	// that ply on, pvLength[ply] where it ends
+	Move pv[MAX_PLY + 1][MAX_PLY + 1];
+	int pvLength[MAX_PLY + 1] = {};
+
+	// Move ordering memory, private to the thread: quiet moves that caused a cutoff
+	// at each ply, how often each from/to pair did so for each side, and the reply
+	// that refuted each previous move
+	Move killers[MAX_PLY][2];
+	int history[2][SQUARE_NB][SQUARE_NB] = {};
+	Move counterMoves[SQUARE_NB][SQUARE_NB];
+
+	PawnTable pawns;
+};
+
+// Ordering classes, tried from the highest score down: the hash move, captures
+// that do not lose material, killers, the countermove, the other quiet moves by
+// history and finally the losing captures
+constexpr int HASH_MOVE_SCORE = 1 << 30;
+constexpr int GOOD_CAPTURE_SCORE = 1 << 28;
+constexpr int KILLER_SCORE = 1 << 27;
+constexpr int COUNTER_MOVE_SCORE = KILLER_SCORE - 2;
+constexpr int BAD_CAPTURE_SCORE = -(1 << 28);
+constexpr int HISTORY_LIMIT = 1 << 20;
+
+// Selective search parameters. Depths are in plies, margins in centipawns.
+constexpr int NULL_MOVE_MIN_DEPTH = 3;
+constexpr int FUTILITY_MAX_DEPTH = 2;
+constexpr int REVERSE_FUTILITY_MAX_DEPTH = 3;
+constexpr int FUTILITY_MARGIN = 150;   // per ply of remaining depth
+constexpr int LMR_MIN_DEPTH = 3;
+constexpr int LMR_MIN_MOVES = 3;       // the hash move, good captures and killers come first
+
+// Root window around the previous iteration's score, doubled on each failure
+// until it is given up for the full window
+constexpr int ASPIRATION_MIN_DEPTH = 4;
+constexpr int ASPIRATION_WINDOW = 25;
+constexpr int ASPIRATION_LIMIT = 1000;
+
+// How often, in nodes, a worker publishes its node count and the main thread checks the limits
+constexpr uint64_t CHECK_INTERVAL = 1024;
+
+void Search::setThreads(int threads)
+{
+	m_threads = std::max(1, threads);
+}
+
+int64_t Search::elapsedMs() const
+{
+	auto elapsed = std::chrono::steady_clock::now() - m_start;
+	return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+void Search::checkLimits(const Worker& worker)
+{
+	m_sharedNodes.fetch_add(CHECK_INTERVAL, std::memory_order_relaxed);
+	if (worker.id != 0) {
+		return;
+	}
+
+	if (m_limits.nodes && m_sharedNodes.load(std::memory_order_relaxed) >= m_limits.nodes) {
+		m_stopFlag = true;
+	}
+	if (m_limits.moveTimeMs && !m_pondering.load(std::memory_order_relaxed) && elapsedMs() >= m_limits.moveTimeMs) {
+		m_stopFlag = true;
+	}
+}
+
+// Mate scores are stored relative to the node rather than the root, so the
+// entry stays valid when the position is reached at another ply
+static int scoreToTT(int score, int ply)
+{
+	return (score >= MATE_BOUND) ? score + ply : (score <= -MATE_BOUND) ? score - ply : score;
+}
+
+static int scoreFromTT(int score, int ply)
+{
+	return (score >= MATE_BOUND) ? score - ply : (score <= -MATE_BOUND) ? score + ply : score;
+}
+
+bool Search::isStopped(const Worker& worker) const
+{
+	// The main thread ignores the flag until its first iteration is done, so there
+	// is always a move to return
+	return m_stopFlag.load(std::memory_order_relaxed) && (worker.id != 0 || worker.completedDepth > 0);
+}
+
+static bool isQuiet(const Board& board, const Move& move)
+{
+	return board.pieceTypeAt(move.to()) == PieceType::Empty && move.flag() != MoveFlag::EnPassant
+		&& move.flag() != MoveFlag::Promotion;
+}
+
+// Most valuable victim first, and the least valuable attacker among equal victims
+static int captureScore(const Board& board, const Move& move)
+{
+	PieceType victim = (move.flag() == MoveFlag::EnPassant) ? PieceType::Pawn : board.pieceTypeAt(move.to());
+	PieceType attacker = board.pieceTypeAt(move.from());
+	return 8 * static_cast<int>(victim) - static_cast<int>(attacker) + 8 * static_cast<int>(move.promotion());
+}
+
+// Swap the best scored of the remaining moves into place i. Picking one at a time
+// skips sorting the moves a cutoff makes unnecessary.
+static void pickMove(MoveList& moves, int* scores, size_t i)
+{
+	size_t best = i;
+	for (size_t j = i + 1; j < moves.size(); ++j) {
+		if (scores[j] > scores[best]) {
+			best = j;
+		}
+	}
+	std::swap(moves[i], moves[best]);
+	std::swap(scores[i], scores[best]);
+}
+
+static void orderCaptures(const Board& board, MoveList& moves)
+{
+	int scores[MAX_MOVES];
+	for (size_t i = 0; i < moves.size(); ++i) {
+		scores[i] = captureScore(board, moves[i]);
+	}
+
+	// Insertion sort, the lists are short
+	for (size_t i = 1; i < moves.size(); ++i) {
+		Move move = moves[i];
+		int score = scores[i];
+		size_t j = i;
+		for (; j > 0 && scores[j - 1] < score; --j) {
+			moves[j] = moves[j - 1];
+			scores[j] = scores[j - 1];
+		}
+		moves[j] = move;
+		scores[j] = score;
+	}
+}
+
+void Search::scoreMoves(const Worker& worker, const MoveList& moves, Move hash_move, int ply, int* scores)
+{
+	const Board& board = worker.board;
+	int side = (board.getSideToMove() == PieceColor::White) ? 0 : 1;
+	Move last = board.getLastMove();
+	Move counter = last.isValid() ? worker.counterMoves[last.from()][last.to()] : Move();
+
+	for (size_t i = 0; i < moves.size(); ++i) {
+		const Move& move = moves[i];
+		if (move == hash_move) {
+			scores[i] = HASH_MOVE_SCORE;
+		} else if (!isQuiet(board, move)) {
+			scores[i] = ((board.staticExchange(move) >= 0) ? GOOD_CAPTURE_SCORE : BAD_CAPTURE_SCORE) + captureScore(board, move);
+		} else if (move == worker.killers[ply][0]) {
+			scores[i] = KILLER_SCORE;
+		} else if (move == worker.killers[ply][1]) {
+			scores[i] = KILLER_SCORE - 1;
+		} else if (move == counter) {
+			scores[i] = COUNTER_MOVE_SCORE;
+		} else {
+			scores[i] = worker.history[side][move.from()][move.to()];
+		}
+	}
+}
+
+void Search::recordCutoff(Worker& worker, const Move& move, size_t index, int depth, int ply)
+{
+	worker.stats.cutoffs++;
+	if (index == 0) {
+		worker.stats.firstMoveCutoffs++;
+	}
+
+	// Captures are already ordered well by their victims
+	const Board& board = worker.board;
+	if (!isQuiet(board, move)) {
+		return;
+	}
+
+	if (worker.killers[ply][0] != move) {
+		worker.killers[ply][1] = worker.killers[ply][0];
+		worker.killers[ply][0] = move;
+	}
+
+	Move last = board.getLastMove();
+	if (last.isValid()) {
+		worker.counterMoves[last.from()][last.to()] = move;
+	}
+
+	// Deep cutoffs count for more. Halve the table when it grows too large, which
+	// also lets older results fade.
+	int side = (board.getSideToMove() == PieceColor::White) ? 0 : 1;
+	int& entry = worker.history[side][move.from()][move.to()];
+	entry += depth * depth;
+	if (entry >= HISTORY_LIMIT) {
+		for (auto& row : worker.history[side]) {
+			for (int& value : row) {
+				value /= 2;
+			}
+		}
+	}
+}
+
+// Resolves the captures left at the horizon so the static evaluation is only
+// taken in quiet positions. Each side may stand pat on the evaluation instead of
+// capturing; in check every evasion is searched.
+int Search::quiescence(Worker& worker, int ply, int alpha, int beta)
+{
+	Board& board = worker.board;
+	worker.stats.qnodes++;
+	if (++worker.stats.nodes % CHECK_INTERVAL == 0) {
+		checkLimits(worker);
+	}
+
+	if (ply >= MAX_PLY) {
+		worker.stats.evaluations++;
+		return board.evaluate();
+	}
+
+	bool maximizing = (board.getSideToMove() == PieceColor::White);
+	bool in_check = board.inCheck();
+	int bestEval;
+	MoveList moves;
+
+	if (in_check) {
+		moves = board.getLegalMoves();
+		if (moves.empty()) {
+			return maximizing ? -(MATE_SCORE - ply) : MATE_SCORE - ply;
+		}
+		bestEval = maximizing ? std::numeric_limits<int>::min() : std::numeric_limits<int>::max();
+	} else {
+		worker.stats.evaluations++;
+		bestEval = board.evaluate();
+		if (maximizing ? (bestEval >= beta) : (bestEval <= alpha)) {
+			return bestEval;
+		}
+		if (maximizing) {
+			alpha = std::max(alpha, bestEval);
+		} else {
+			beta = std::min(beta, bestEval);
+		}
+		moves = board.getLegalCaptures();
+	}
+	orderCaptures(board, moves);
+
+	for (const Move& move : moves) {
+		// Captures that lose material by exchange are not worth a look
+		if (!in_check && board.staticExchange(move) < 0) {
+			continue;
+		}
+
+		board.makeMove(move);
+		int eval = quiescence(worker, ply + 1, alpha, beta);
+		board.undoMove(move);
+		if (isStopped(worker)) {
+			return 0;
+		}
+
+		if (maximizing) {
+			bestEval = std::max(bestEval, eval);
+			alpha = std::max(alpha, eval);
+		} else {
+			bestEval = std::min(bestEval, eval);
+			beta = std::min(beta, eval);
+		}
+		if (beta <= alpha) {
+			break;
+		}
+	}
+
+	return bestEval;
+}
+
+int Search::minimax(Worker& worker, int depth, int ply, int alpha, int beta) 
+{
+	Board& board = worker.board;
+	worker.pvLength[ply] = ply;
+
+	// Drawn by rule whatever follows, so there is nothing to search, and checked
+	// before the table, whose entry may come from a path without the repetition
+	if (board.isDraw(ply)) {
+		worker.stats.drawCutoffs++;
+		return 0;
+	}
+
+	if (depth <= 0) {
+		return quiescence(worker, ply, alpha, beta);
+	}
+
+	if (++worker.stats.nodes % CHECK_INTERVAL == 0) {
+		checkLimits(worker);
+	}
+
+	// Only nodes searched with an open window can be on the principal variation;
+	// every other node is a null window scout that just has to fail high or low
+	bool pv_node = (alpha + 1 < beta);
+
+	// A stored result that is deep enough can narrow the window or end the node
+	// outright, though not on the principal variation, which would be cut short
+	uint64_t key = board.getKey();
+	int alpha_orig = alpha, beta_orig = beta;
+	Move hash_move;
+	TTEntry entry;
+	worker.stats.ttProbes++;
+	if (m_tt.probe(key, entry)) {
+		worker.stats.ttHits++;
+		hash_move = Move(entry.move);
+		int score = scoreFromTT(entry.score, ply);
+		if (entry.depth >= depth && !pv_node) {
+			if (entry.bound() == Bound::Exact) {
+				worker.stats.ttCutoffs++;
+				return score;
+			} else if (entry.bound() == Bound::Lower) {
+				alpha = std::max(alpha, score);
+			} else if (entry.bound() == Bound::Upper) {
+				beta = std::min(beta, score);
+			}
+
+			if (alpha >= beta) {
+				worker.stats.ttCutoffs++;
+				return score;
+			}
+		}
+	}
+
+	// Without a legal move the game is over: checkmate when in check, otherwise
+	// stalemate, which is a draw
+	bool isMaximizingPlayer = (board.getSideToMove() == PieceColor::White);
+	bool in_check = board.inCheck();
+	MoveList moves = board.getLegalMoves();
+	if (moves.empty()) {
+		if (!in_check) {
+			return 0;
+		}
+		return isMaximizingPlayer ? -(MATE_SCORE - ply) : MATE_SCORE - ply;
+	}
+
+	// Near the leaves, a static evaluation far outside the window is trusted to
+	// hold. The window bounds double as infinity, so mate scores are never pruned.
+	int static_eval = 0;
+	if (!in_check) {
+		worker.stats.evaluations++;
+		static_eval = board.evaluate();
+	}
+	if (m_options.futility && !pv_node && !in_check && depth <= REVERSE_FUTILITY_MAX_DEPTH) {
+		int margin = FUTILITY_MARGIN * depth;
+		if (isMaximizingPlayer ? (beta < MATE_BOUND && static_eval - margin >= beta)
+				: (alpha > -MATE_BOUND && static_eval + margin <= alpha)) {
+			worker.stats.futilityPrunes++;
+			return static_eval;
+		}
+	}
+
+	// Null move pruning: if passing the turn still fails high, a real move will
+	// too. Not after another null move, and not without pieces, where passing
+	// would often be better than any move.
+	if (m_options.nullMove && !pv_node && !in_check && depth >= NULL_MOVE_MIN_DEPTH && board.getLastMove().isValid()
+			&& board.hasNonPawnMaterial(board.getSideToMove())
+			&& (isMaximizingPlayer ? static_eval >= beta : static_eval <= alpha)) {
+		int reduction = (depth > 6) ? 3 : 2;
+		board.makeNullMove();
+		int eval = isMaximizingPlayer ? minimax(worker, depth - 1 - reduction, ply + 1, beta - 1, beta)
+			: minimax(worker, depth - 1 - reduction, ply + 1, alpha, alpha + 1);
+		board.undoNullMove();
+		if (isStopped(worker)) {
+			return 0;
+		}
+
+		// A mate found after passing proves nothing, so only the bound is returned
+		if (isMaximizingPlayer ? eval >= beta : eval <= alpha) {
+			worker.stats.nullMoveCutoffs++;
+			bool mate = (eval >= MATE_BOUND || eval <= -MATE_BOUND);
+			return mate ? (isMaximizingPlayer ? beta : alpha) : eval;
+		}
+	}
+
+	// At the frontier, quiet moves cannot lift a hopeless evaluation into the window
+	bool futile = m_options.futility && !pv_node && !in_check && depth <= FUTILITY_MAX_DEPTH
+		&& (isMaximizingPlayer ? static_eval + FUTILITY_MARGIN * depth <= alpha
+			: static_eval - FUTILITY_MARGIN * depth >= beta);
+
+	// Searches the move just made (principal variation search). The first move gets
+	// the full window; the others only have to show they cannot beat it, with a
+	// null window scout, shallower for late quiet moves. A scout that does beat it
+	// is repeated at full depth, then with the full window.
+	auto searchChild = [&](size_t i, bool quiet) {
+		if (i == 0) {
+			return minimax(worker, depth - 1, ply + 1, alpha, beta);
+		}
+
+		auto scout = [&](int scout_depth) {
+			return isMaximizingPlayer ? minimax(worker, scout_depth, ply + 1, alpha, alpha + 1)
+				: minimax(worker, scout_depth, ply + 1, beta - 1, beta);
+		};
+		auto beatsBound = [&](int eval) { return isMaximizingPlayer ? eval > alpha : eval < beta; };
+
+		int eval;
+		if (m_options.lateMoveReductions && depth >= LMR_MIN_DEPTH && i >= LMR_MIN_MOVES
+				&& quiet && !in_check && !board.inCheck()) {
+			int reduction = (depth >= 6 && i >= 6) ? 2 : 1;
+			worker.stats.reductions++;
+			eval = scout(depth - 1 - reduction);
+			if (beatsBound(eval)) {
+				worker.stats.researches++;
+				eval = scout(depth - 1);
+			}
+		} else {
+			eval = scout(depth - 1);
+		}
+
+		if (pv_node && eval > alpha && eval < beta) {
+			worker.stats.researches++;
+			eval = minimax(worker, depth - 1, ply + 1, alpha, beta);
+		}
+		return eval;
+	};
+
+	int scores[MAX_MOVES];
+	scoreMoves(worker, moves, hash_move, ply, scores);
+
+	Move bestMove;
+	int bestEval;
+
+	if (isMaximizingPlayer) {
+		bestEval = std::numeric_limits<int>::min();
+		for (size_t i = 0; i < moves.size(); ++i) {
+			pickMove(moves, scores, i);
+			const Move move = moves[i];
+			bool quiet = isQuiet(board, move);
+			board.makeMove(move);
+			if (futile && i > 0 && quiet && !board.inCheck()) {
+				board.undoMove(move);
+				worker.stats.futilityPrunes++;
+				continue;
+			}
+			int eval = searchChild(i, quiet);
+			board.undoMove(move);
+			if (isStopped(worker)) {
+				return 0;
+			}
+			if (eval > bestEval) {
+				bestEval = eval;
+				bestMove = move;
+				if (eval > alpha) {
+					updatePv(worker, ply, move);
+				}
+			}
+			alpha = std::max(alpha, eval);
+			if (beta <= alpha) {
+				recordCutoff(worker, move, i, depth, ply);
+				break;
+			}
+		}
+	} else {
+		bestEval = std::numeric_limits<int>::max();
+		for (size_t i = 0; i < moves.size(); ++i) {
+			pickMove(moves, scores, i);
+			const Move move = moves[i];
+			bool quiet = isQuiet(board, move);
+			board.makeMove(move);
+			if (futile && i > 0 && quiet && !board.inCheck()) {
+				board.undoMove(move);
+				worker.stats.futilityPrunes++;
+				continue;
+			}
+			int eval = searchChild(i, quiet);
+			board.undoMove(move);
+			if (isStopped(worker)) {
+				return 0;
+			}
+			if (eval < bestEval) {
+				bestEval = eval;
+				bestMove = move;
+				if (eval < beta) {
+					updatePv(worker, ply, move);
+				}
+			}
+			beta = std::min(beta, eval);
+			if (beta <= alpha) {
+				recordCutoff(worker, move, i, depth, ply);
+				break;
+			}
+		}
+	}
+
+	// Scores are from White's point of view, so the bound is the same for both sides
+	Bound bound = (bestEval <= alpha_orig) ? Bound::Upper : (bestEval >= beta_orig) ? Bound::Lower : Bound::Exact;
+	m_tt.store(key, depth, bound, scoreToTT(bestEval, ply), bestMove.raw());
+	return bestEval;
+}
+
+void Search::updatePv(Worker& worker, int ply, const Move& move)
+{
+	worker.pv[ply][ply] = move;
+	for (int i = ply + 1; i < worker.pvLength[ply + 1]; ++i) {
+		worker.pv[ply][i] = worker.pv[ply + 1][i];
+	}
+	worker.pvLength[ply] = std::max(worker.pvLength[ply + 1], ply + 1);
+}
+
+// Searches every root move within (alpha, beta) and returns the best score, which
+// is only a bound when it falls outside the window. The line behind it is left
+// in pv[0].
+int Search::searchRoot(Worker& worker, int depth, int alpha, int beta)
+{
+	Board& board = worker.board;
+	bool maximizing = (board.getSideToMove() == PieceColor::White);
+	int alpha_orig = alpha, beta_orig = beta;
+	int bestValue = maximizing ? std::numeric_limits<int>::min() : std::numeric_limits<int>::max();
+	Move bestMove;
+	MoveList moves = board.getLegalMoves();
+	worker.pvLength[0] = 0;
+
+	TTEntry entry;
+	Move hash_move = m_tt.probe(board.getKey(), entry) ? Move(entry.move) : Move();
+	int scores[MAX_MOVES];
+	scoreMoves(worker, moves, hash_move, 0, scores);
+	for (size_t i = 0; i < moves.size(); ++i) {
+		pickMove(moves, scores, i);
+	}
+
+	// Helpers start from a different root move each, so the threads fill the
+	// table with different subtrees before the main thread reaches them
+	if (worker.id != 0 && !moves.empty()) {
+		size_t offset = (worker.id * moves.size() / m_threads) % moves.size();
+		std::rotate(moves.begin(), moves.begin() + offset, moves.end());
+	}
+
+	// Later moves are scouted with a null window against the best so far
+	for (size_t i = 0; i < moves.size(); ++i) {
+		const Move move = moves[i];
+		board.makeMove(move);
+		int value;
+		if (i == 0) {
+			value = minimax(worker, depth - 1, 1, alpha, beta);
+		} else {
+			value = maximizing ? minimax(worker, depth - 1, 1, alpha, alpha + 1)
+				: minimax(worker, depth - 1, 1, beta - 1, beta);
+			if (value > alpha && value < beta) {
+				worker.stats.researches++;
+				value = minimax(worker, depth - 1, 1, alpha, beta);
+			}
+		}
+		board.undoMove(move);
+
+		if (isStopped(worker)) {
+			return bestValue;
+		}
+
+		if (maximizing ? (value > bestValue) : (value < bestValue)) {
+			bestValue = value;
+			bestMove = move;
+			updatePv(worker, 0, move);
+		}
+
+		if (maximizing) {
+			alpha = std::max(alpha, value);
+		} else {
+			beta = std::min(beta, value);
+		}
+		if (alpha >= beta) {
+			break;
+		}
+	}
+
+	if (bestMove.isValid()) {
+		Bound bound = (bestValue <= alpha_orig) ? Bound::Upper : (bestValue >= beta_orig) ? Bound::Lower : Bound::Exact;
+		m_tt.store(board.getKey(), depth, bound, scoreToTT(bestValue, 0), bestMove.raw());
+	}
+	return bestValue;
+}
+
+void Search::iterativeDeepening(Worker& worker)
+{
+	int max_depth = (m_limits.depth > 0) ? std::min(m_limits.depth, MAX_SEARCH_DEPTH) : MAX_SEARCH_DEPTH;
+
+	// Half of the helpers stay one ply ahead, which spreads the threads further apart
+	int first_depth = (worker.id != 0) ? 1 + (worker.id & 1) : 1;
+
+	for (int depth = first_depth; depth <= max_depth; ++depth) {
+		int alpha = std::numeric_limits<int>::min();
+		int beta = std::numeric_limits<int>::max();
+		int delta = ASPIRATION_WINDOW;
+		bool mate = (worker.score >= MATE_BOUND || worker.score <= -MATE_BOUND);
+		if (depth >= ASPIRATION_MIN_DEPTH && worker.completedDepth > 0 && !mate) {
+			alpha = worker.score - delta;
+			beta = worker.score + delta;
+		}
+
+		// Widen whichever side of the window the score fell through and search again
+		int score;
+		while (true) {
+			score = searchRoot(worker, depth, alpha, beta);
+			if (isStopped(worker) || worker.pvLength[0] == 0) {
+				break;
+			}
+
+			if (score <= alpha) {
+				alpha = (delta >= ASPIRATION_LIMIT) ? std::numeric_limits<int>::min() : score - delta;
+			} else if (score >= beta) {
+				beta = (delta >= ASPIRATION_LIMIT) ? std::numeric_limits<int>::max() : score + delta;
+			} else {
+				break;
+			}
+			delta *= 2;
+			worker.stats.aspirationResearches++;
+		}
+
+		// An interrupted iteration is discarded; the previous one stands
+		if (isStopped(worker)) {
+			break;
+		}
+
+		if (worker.pvLength[0] == 0) {
+			break; // no moves at the root
+		}
+
+		worker.rootPv.assign(worker.pv[0], worker.pv[0] + worker.pvLength[0]);
+		worker.bestMove = worker.rootPv[0];
+		worker.score = score;
+		worker.completedDepth = depth;
+
+		if (worker.id == 0 && m_infoCallback) {
+			SearchInfo info;
+			info.depth = depth;
+			info.score = score;
+			info.nodes = m_sharedNodes.load(std::memory_order_relaxed) + worker.stats.nodes % CHECK_INTERVAL;
+			info.timeMs = elapsedMs();
+			info.pv = worker.rootPv;
+			m_infoCallback(info);
+		}
+
+		// Don't start an iteration that is unlikely to finish in the remaining time
+		if (worker.id == 0 && m_limits.moveTimeMs && !m_pondering && elapsedMs() * 2 > m_limits.moveTimeMs) {
+			break;
+		}
+	}
+}
+
+// Resets the limits and flags in the calling thread, so that a stop() or
+// ponderHit() right after start() cannot be lost
+void Search::prepare(const SearchLimits& limits)
+{
+	m_start = std::chrono::steady_clock::now();
+	m_limits = limits;
+	m_stopFlag = false;
+	m_pondering = limits.ponder;
+	m_sharedNodes = 0;
+	m_tt.newSearch();
+}
+
+Move Search::findBestMove(const Board& board, const SearchLimits& limits) 
+{
+	wait();
+	prepare(limits);
+	return run(board);
+}
+
+void Search::start(const Board& board, const SearchLimits& limits)
+{
+	wait();
+	prepare(limits);
+	m_running = true;
+	m_thread = std::thread([this, board]() {
+		m_result = run(board);
+		m_running = false;
+	});
+}
+
+Move Search::wait()
+{
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+	return m_result;
+}
+
+Move Search::run(const Board& board)
+{
+	std::vector<Worker> workers;
+	workers.reserve(m_threads);
+	for (int i = 0; i < m_threads; ++i) {
+		workers.emplace_back(board);
+		workers[i].id = i;
+	}
+	std::vector<std::thread> helpers;
+	for (Worker& worker : workers) {
+		worker.board.setNetwork(m_network);
+		worker.board.setPawnTable(&worker.pawns);
+	}
+	for (int i = 1; i < m_threads; ++i) {
+		helpers.emplace_back([this, &workers, i]() { iterativeDeepening(workers[i]); });
+	}
+
+	iterativeDeepening(workers[0]);
+
+	m_stopFlag = true;
+	for (std::thread& helper : helpers) {
+		helper.join();
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_start;
+	m_lastStats = SearchStats{};
+	m_lastStats.depth = workers[0].completedDepth;
+	m_lastStats.score = workers[0].score;
+	m_lastStats.pv = workers[0].rootPv;
+	m_lastStats.threads = m_threads;
+	m_lastStats.seconds = elapsed.count();
+	for (const Worker& worker : workers) {
+		m_lastStats.nodes += worker.stats.nodes;
+		m_lastStats.qnodes += worker.stats.qnodes;
+		m_lastStats.ttProbes += worker.stats.ttProbes;
+		m_lastStats.ttHits += worker.stats.ttHits;
+		m_lastStats.ttCutoffs += worker.stats.ttCutoffs;
+		m_lastStats.cutoffs += worker.stats.cutoffs;
+		m_lastStats.firstMoveCutoffs += worker.stats.firstMoveCutoffs;
+		m_lastStats.nullMoveCutoffs += worker.stats.nullMoveCutoffs;
+		m_lastStats.reductions += worker.stats.reductions;
+		m_lastStats.researches += worker.stats.researches;
+		m_lastStats.futilityPrunes += worker.stats.futilityPrunes;
+		m_lastStats.drawCutoffs += worker.stats.drawCutoffs;
+		m_lastStats.evaluations += worker.stats.evaluations;
+		m_lastStats.pawnProbes += worker.pawns.probes();
+		m_lastStats.pawnHits += worker.pawns.hits();
+		m_lastStats.aspirationResearches += worker.stats.aspirationResearches;
+	}
+
+	m_result = workers[0].bestMove;
+	return m_result;
+}
+
+Move Search::findBestMove(const Board& board, int depth)
+{
+	SearchLimits limits;
+	limits.depth = depth;
+	return findBestMove(board, limits);
+}
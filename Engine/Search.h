@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "Board.h"
+#include "TranspositionTable.h"
+
+constexpr int MAX_SEARCH_DEPTH = 64;
+constexpr int MAX_PLY = 2 * MAX_SEARCH_DEPTH; // including the quiescence search
+
+// Getting mated n plies from the root scores -(MATE_SCORE - n) for the mated side,
+// so shorter mates are preferred. Anything beyond MATE_BOUND is a mate score.
+constexpr int MATE_SCORE = 1000000;
+constexpr int MATE_BOUND = MATE_SCORE - MAX_PLY;
+
+// A zero field means no limit of that kind. With no limits at all the search
+// runs until stop() is called.
+struct SearchLimits {
+	int depth = 0;
+	uint64_t nodes = 0;
+	int moveTimeMs = 0;
+	bool ponder = false; // on the opponent's time: the time limit waits for ponderHit()
+};
+
+// Selective search, all on by default. Each part can be switched off to weigh
+// the nodes it saves against the tactics it misses.
+struct SearchOptions {
+	bool nullMove = true;           // null move pruning
+	bool lateMoveReductions = true; // late move reductions, re-searched when they fail
+	bool futility = true;           // futility and reverse futility pruning near the leaves
+};
+
+struct SearchStats {
+	int depth = 0;
+	int score = 0;             // from White's point of view
+	std::vector<Move> pv;      // principal variation, starting with the best move
+	int threads = 1;
+	uint64_t nodes = 0;
+	uint64_t qnodes = 0; // the part of nodes spent in the quiescence search
+	uint64_t ttProbes = 0;
+	uint64_t ttHits = 0;
+	uint64_t ttCutoffs = 0;
+	uint64_t cutoffs = 0;          // beta cutoffs in the main search
+	uint64_t firstMoveCutoffs = 0; // of which by the first move tried
+	uint64_t nullMoveCutoffs = 0;
+	uint64_t reductions = 0;       // late moves searched at reduced depth
+	uint64_t researches = 0;       // scouts and reduced searches repeated in full
+	uint64_t aspirationResearches = 0; // root iterations repeated with a wider window
+	uint64_t futilityPrunes = 0;   // nodes and moves cut by (reverse) futility pruning
+	uint64_t drawCutoffs = 0;      // nodes ended by repetition, the fifty-move rule or insufficient material
+	uint64_t evaluations = 0;
+	uint64_t pawnProbes = 0;
+	uint64_t pawnHits = 0;
+	double seconds = 0;
+
+	double ttHitRate() const { return ttProbes ? static_cast<double>(ttHits) / ttProbes : 0.0; };
+	double pawnHitRate() const { return pawnProbes ? static_cast<double>(pawnHits) / pawnProbes : 0.0; };
+	double firstMoveCutoffRate() const { return cutoffs ? static_cast<double>(firstMoveCutoffs) / cutoffs : 0.0; };
+	uint64_t nodesPerSecond() const { return seconds > 0 ? static_cast<uint64_t>(nodes / seconds) : 0; };
+	uint64_t evaluationsPerSecond() const { return seconds > 0 ? static_cast<uint64_t>(evaluations / seconds) : 0; };
+};
+
+// Sent after every completed iteration of the main search thread
+struct SearchInfo {
+	int depth = 0;
+	int score = 0;         // from White's point of view
+	uint64_t nodes = 0;    // all threads, approximately
+	int64_t timeMs = 0;
+	std::vector<Move> pv;
+};
+
+// One engine instance: its own transposition table, thread count and limits.
+// Any number of instances can search at the same time, each on its own
+// positions; a game only needs a Board, so idle games cost no table memory.
+class Search
+{
+public:
+	Search(size_t hash_mb = 16) : m_tt(hash_mb) {};
+	~Search() { stop(); wait(); };
+
+	Move findBestMove(const Board& board, const SearchLimits& limits);
+	Move findBestMove(const Board& board, int depth);
+	void stop() { m_stopFlag = true; };
+
+	// The same search on a thread of its own, for callers that must stay responsive.
+	// wait() returns its move once it has ended, after stop() or its limits.
+	void start(const Board& board, const SearchLimits& limits);
+	Move wait();
+	bool isRunning() const { return m_running; };
+
+	// Called on the search thread, so it must hand the information over rather
+	// than act on it
+	void setInfoCallback(std::function<void(const SearchInfo&)> callback) { m_infoCallback = std::move(callback); };
+
+	// The opponent played the move being pondered on: the time limit applies from
+	// now on, counting the time already spent
+	void ponderHit() { m_pondering = false; };
+
+	void setHashSize(size_t mb) { m_tt.resize(mb); };
+	size_t getHashSize() const { return m_tt.sizeMB(); };
+	void clearHash() { m_tt.clear(); };
+	void setThreads(int threads);
+	int getThreads() const { return m_threads; };
+	void setOptions(const SearchOptions& options) { m_options = options; };
+	const SearchOptions& getOptions() const { return m_options; };
+
+	// Evaluates with the network instead of the piece-square tables; null to switch
+	// back. The network is not owned and must outlive the searches using it.
+	void setNetwork(const NnueNetwork* network) { m_network = network; };
+	const NnueNetwork* getNetwork() const { return m_network; };
+	const SearchStats& getLastStats() const { return m_lastStats; };
+
+private:
+	struct Worker;
+
+	TranspositionTable m_tt;
+	SearchStats m_lastStats;
+	int m_threads = 1;
+	SearchOptions m_options;
+	const NnueNetwork* m_network = nullptr;
+
+	// Limits of the running search. The stop flag is raised by the main thread when
+	// a limit is reached, or by any other thread through stop().
+	SearchLimits m_limits;
+	std::chrono::steady_clock::time_point m_start;
+	std::atomic<bool> m_stopFlag{ false };
+	std::atomic<bool> m_pondering{ false };
+	std::atomic<uint64_t> m_sharedNodes{ 0 };
+
+	std::thread m_thread; // running start()
+	std::atomic<bool> m_running{ false };
+	Move m_result;
+	std::function<void(const SearchInfo&)> m_infoCallback;
+
+	void prepare(const SearchLimits& limits);
+	Move run(const Board& board);
+	int64_t elapsedMs() const;
+	void checkLimits(const Worker& worker);
+	bool isStopped(const Worker& worker) const;
+	static void scoreMoves(const Worker& worker, const MoveList& moves, Move hash_move, int ply, int* scores);
+	static void recordCutoff(Worker& worker, const Move& move, size_t index, int depth, int ply);
+	int minimax(Worker& worker, int depth, int ply, int alpha, int beta);
+	int quiescence(Worker& worker, int ply, int alpha, int beta);
+	static void updatePv(Worker& worker, int ply, const Move& move);
+	int searchRoot(Worker& worker, int depth, int alpha, int beta);
+	void iterativeDeepening(Worker& worker);
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Ring buffer for handing items from one thread to one other without locks.
+// Only one thread may push and only one other thread may pop. Pushing to a full
+// queue fails, leaving the item with the producer.
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+public:
+	bool push(const T& item)
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		size_t next = (tail + 1) % Capacity;
+		if (next == m_head.load(std::memory_order_acquire)) {
+			return false;
+		}
+		m_items[tail] = item;
+		m_tail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T& item)
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		item = std::move(m_items[head]);
+		m_head.store((head + 1) % Capacity, std::memory_order_release);
+		return true;
+	}
+
+private:
+	T m_items[Capacity];
+
+	// On separate cache lines so the two threads do not contend for one
+	alignas(64) std::atomic<size_t> m_head{ 0 }; // next item to pop
+	alignas(64) std::atomic<size_t> m_tail{ 0 }; // next slot to push into
+};
@@ -0,0 +1,84 @@
+#include "TranspositionTable.h"
+
+static uint64_t packEntry(int score, uint16_t move, int depth, uint8_t genBound)
+{
+	return static_cast<uint32_t>(score) | (static_cast<uint64_t>(move) << 32)
+		| (static_cast<uint64_t>(depth) << 48) | (static_cast<uint64_t>(genBound) << 56);
+}
+
+static TTEntry unpackEntry(uint64_t key, uint64_t data)
+{
+	return TTEntry{ key, static_cast<int32_t>(static_cast<uint32_t>(data)), static_cast<uint16_t>(data >> 32),
+		static_cast<uint8_t>(data >> 48), static_cast<uint8_t>(data >> 56) };
+}
+
+void TranspositionTable::resize(size_t mb)
+{
+	// Round down to a power of two number of buckets so the index is a mask
+	size_t count = 1;
+	size_t bytes = (mb ? mb : 1) << 20;
+	while (count * 2 * sizeof(Bucket) <= bytes) {
+		count *= 2;
+	}
+
+	m_buckets.reset(new Bucket[count]());
+	m_count = count;
+	m_mask = count - 1;
+	clear();
+}
+
+void TranspositionTable::clear()
+{
+	for (size_t i = 0; i < m_count; ++i) {
+		for (Slot& slot : m_buckets[i].slots) {
+			slot.key.store(0, std::memory_order_relaxed);
+			slot.data.store(0, std::memory_order_relaxed);
+		}
+	}
+	m_generation = 0;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry& entry) const
+{
+	for (const Slot& slot : bucketFor(key).slots) {
+		uint64_t data = slot.data.load(std::memory_order_relaxed);
+		if ((slot.key.load(std::memory_order_relaxed) ^ data) == key && data) {
+			entry = unpackEntry(key, data);
+			return entry.bound() != Bound::None;
+		}
+	}
+
+	return false;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, Bound bound, int score, uint16_t move)
+{
+	Bucket& bucket = bucketFor(key);
+	Slot* replace = &bucket.slots[0];
+	int replace_worth = 0;
+
+	for (Slot& slot : bucket.slots) {
+		uint64_t data = slot.data.load(std::memory_order_relaxed);
+		uint64_t slot_key = slot.key.load(std::memory_order_relaxed) ^ data;
+		TTEntry candidate = unpackEntry(slot_key, data);
+
+		// Reuse the slot of the same position, keeping its move if we have none
+		if (slot_key == key) {
+			if (!move) move = candidate.move;
+			replace = &slot;
+			break;
+		}
+
+		// Otherwise evict the shallowest entry, treating ones from older searches as shallower
+		int worth = candidate.depth - 8 * ((64 + m_generation - candidate.generation()) & 63);
+		if (&slot == &bucket.slots[0] || worth < replace_worth) {
+			replace = &slot;
+			replace_worth = worth;
+		}
+	}
+
+	uint8_t genBound = static_cast<uint8_t>((m_generation << 2) | static_cast<uint8_t>(bound));
+	uint64_t data = packEntry(score, move, depth, genBound);
+	replace->key.store(key ^ data, std::memory_order_relaxed);
+	replace->data.store(data, std::memory_order_relaxed);
+}
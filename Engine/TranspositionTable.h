@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+enum class Bound : uint8_t { None = 0, Upper, Lower, Exact };
+
+struct TTEntry {
+	uint64_t key;
+	int32_t score;
+	uint16_t move; // Move::raw()
+	uint8_t depth;
+	uint8_t genBound; // generation in the upper six bits, Bound in the lower two
+
+	Bound bound() const { return static_cast<Bound>(genBound & 3); };
+	uint8_t generation() const { return genBound >> 2; };
+};
+
+// Shared by all search threads without locks. Each slot stores the key xor-ed
+// with the packed data, so a slot torn by two concurrent writers no longer
+// matches any key and is simply ignored by probe().
+class TranspositionTable
+{
+public:
+	static constexpr int BUCKET_SIZE = 4;
+
+	TranspositionTable(size_t mb = 16) { resize(mb); };
+
+	void resize(size_t mb);
+	void clear();
+	void newSearch() { m_generation = (m_generation + 1) & 63; };
+	bool probe(uint64_t key, TTEntry& entry) const;
+	void store(uint64_t key, int depth, Bound bound, int score, uint16_t move);
+
+	size_t sizeMB() const { return m_count * sizeof(Bucket) >> 20; };
+
+private:
+	struct Slot {
+		std::atomic<uint64_t> key;
+		std::atomic<uint64_t> data;
+	};
+
+	// Slots sharing a bucket fill one cache line
+	struct alignas(64) Bucket {
+		Slot slots[BUCKET_SIZE];
+	};
+
+	std::unique_ptr<Bucket[]> m_buckets;
+	size_t m_count = 0;
+	uint64_t m_mask = 0;
+	uint8_t m_generation = 0;
+
+	Bucket& bucketFor(uint64_t key) const { return m_buckets[key & m_mask]; };
+};
@@ -5,8 +5,7 @@ class Bishop :
 {
 public:
     Bishop(PieceColor col) : Piece(col, PieceType::Bishop) {};
-    bool isValidMove(int src_row, int src_col, int trg_row, int trg_col) const override;
-    bool isPathClear(int src_row, int src_col, int trg_row, int trg_col) const;
+    bool isValidMove(const Board& board, int src_row, int src_col, int trg_row, int trg_col) const override;
     std::string getImagePath() const override;
 };
 
@@ -3,51 +3,44 @@
 #include <array>
 #include "Board.h"
 
-bool King::isValidMove(int src_row, int src_col, int trg_row, int trg_col) const
+bool King::isValidMove(const Board& board, int src_row, int src_col, int trg_row, int trg_col) const
 {
-    std::shared_ptr<Board> board = getBoard();
+    int src = makeSquare(src_row, src_col);
+    int trg = makeSquare(trg_row, trg_col);
 
-    if (src_row == trg_row && src_col == trg_col) {
-        return false;
-    }
-
-    // Check if the target block is within one square of the king's position
-    if (std::abs(trg_row - src_row) <= 1 && std::abs(trg_col - src_col) <= 1) {
-        // Check if the target block is empty or contains an opponent's piece
-        std::shared_ptr<Piece> trg_piece = board->getPiece(trg_row, trg_col);
-        if (!trg_piece || trg_piece->getColor() != this->getColor()) {
-            return true;
-        }
-    }
-
-    return false;
+    // The target must be adjacent and must not hold one of our own pieces
+    return (kingAttacks(src) & ~board.pieces(getColor()) & squareBB(trg)) != 0;
 }
 
-bool King::canCastle(int src_row, int src_col, int trg_row, int trg_col) const
+bool King::canCastle(const Board& board, int src_row, int src_col, int trg_row, int trg_col) const
 {
-    if (abs(trg_col - src_col) != 2 || trg_row != src_row) {
+    int home_row = (getColor() == PieceColor::White) ? 0 : 7;
+    if (abs(trg_col - src_col) != 2 || trg_row != src_row || src_row != home_row || src_col != 4) {
+        return false;
+    }
+
+    // The castling right is lost as soon as the king or that rook moves or the rook is captured
+    bool king_side = (trg_col == 6);
+    if (!(board.getCastlingRights() & castlingRight(getColor(), king_side))) {
         return false;
     }
 
-    // Determine the direction of castling
-    int rook_col = (trg_col == 6) ? 7 : 0;
-    std::shared_ptr<Board> board = getBoard();
-    auto rook = board->getPiece(src_row, rook_col);
-    if (!rook || rook->getType() != PieceType::Rook || rook->hasMoved()) {
+    int rook_col = king_side ? 7 : 0;
+    if (!(board.pieces(getColor(), PieceType::Rook) & squareBB(makeSquare(src_row, rook_col)))) {
         return false;
     }
 
     // Check that there are no pieces between the king and the rook
     int direction = (trg_col - src_col) / 2;
-    for (int col = src_col + direction; col != trg_col; col += direction) {
-        if (board->getPiece(src_row, col)) {
+    for (int col = src_col + direction; col != rook_col; col += direction) {
+        if (board.occupied() & squareBB(makeSquare(src_row, col))) {
             return false;
         }
     }
 
     // Ensure the king is not in check, and does not pass through or land in a square that is under attack
     for (int col = src_col; col != trg_col + direction; col += direction) {
-        if (board->isSquareAttacked(src_row, col, getColor())) {
+        if (board.isSquareAttacked(src_row, col, getColor())) {
             return false;
         }
     }
@@ -5,8 +5,8 @@ class King : public Piece
 public:
     King(PieceColor col) : Piece(col, PieceType::King) {};
 
-    bool isValidMove(int src_row, int src_col, int trg_row, int trg_col) const override;
-    bool canCastle(int src_row, int src_col, int trg_row, int trg_col) const;
+    bool isValidMove(const Board& board, int src_row, int src_col, int trg_row, int trg_col) const override;
+    bool canCastle(const Board& board, int src_row, int src_col, int trg_row, int trg_col) const;
     std::string getImagePath() const override;
 };
 
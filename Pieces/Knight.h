@@ -8,7 +8,7 @@ public:
 	{
 	};
 
-    bool isValidMove(int src_row, int src_col, int trg_row, int trg_col) const override;
+    bool isValidMove(const Board& board, int src_row, int src_col, int trg_row, int trg_col) const override;
     std::string getImagePath() const override;
 };
 
@@ -3,69 +3,44 @@
 #include <array>
 #include "Board.h"
 
-bool Pawn::isValidMove(int src_row, int src_col, int trg_row, int trg_col) const
+bool Pawn::isValidMove(const Board& board, int src_row, int src_col, int trg_row, int trg_col) const
 {
-    std::shared_ptr<Board> board = getBoard();
     int direction = (this->getColor() == PieceColor::White) ? 1 : -1;
-    std::shared_ptr<Piece> trg_piece = board->getPiece(trg_row, trg_col);
+    int start_row = (this->getColor() == PieceColor::White) ? 1 : 6;
+    int src = makeSquare(src_row, src_col);
+    int trg = makeSquare(trg_row, trg_col);
+    Bitboard occupied = board.occupied();
 
-    if (src_row == trg_row && src_col == trg_col) {
-        return false;
+    // Pawn can capture diagonally
+    if (pawnAttacks(getColor(), src) & board.pieces(oppositeColor(getColor())) & squareBB(trg)) {
+        return true;
     }
 
-    if (!trg_piece) {
-        // Pawn can move forward one square
-        if (trg_col == src_col && trg_row == src_row + direction) {
-            return true;
-        } else if (trg_col == src_col && trg_row == src_row + 2 * direction && !hasMoved()) { 
-            // Pawn can move forward two squares from its starting position
+    if ((occupied & squareBB(trg)) || trg_col != src_col) {
+        return false;
+    }
 
-            // Check if the path is clear (no pieces in the way)
-            if (!board->getPiece(src_row + direction, src_col)) {
-                return true;
-            }
-        }
-    } else {
-        // Check if the destination block contains an opponent's piece
-        std::shared_ptr<Piece> piece = board->getPiece(trg_row, trg_col);
-        if (piece && (piece->getColor() != this->getColor())) {
-            // Pawn can capture diagonally
-            if (std::abs(trg_col - src_col) == 1 && trg_row == src_row + direction) {
-                return true;
-            }
-        }
+    // Pawn can move forward one square
+    if (trg_row == src_row + direction) {
+        return true;
     }
-	
-    return false;
-}
 
-static bool isDoubleStep(const Move& move)
-{
-	int rowDiff = abs(move.dest_row - move.src_row);
-	if (rowDiff == 2) {
-		return true;
-	}
-	return false;
+    // Pawn can move forward two squares from its starting row if the path is clear
+    return src_row == start_row && trg_row == src_row + 2 * direction &&
+        !(occupied & squareBB(makeSquare(src_row + direction, src_col)));
 }
 
-bool Pawn::isEnPassant(int src_row, int src_col, int trg_row, int trg_col) const 
+bool Pawn::isEnPassant(const Board& board, int src_row, int src_col, int trg_row, int trg_col) const 
 {
 	if (getType() != PieceType::Pawn) {
 		return false;
 	}
 
-	// Check if the move is a valid en passant capture
-    std::shared_ptr<Board> board = getBoard();
+	// The board only records the en passant square right after a double step
+	// that an enemy pawn can answer
 	int direction = (getColor() == PieceColor::White) ? 1 : -1;
 	if (abs(trg_col - src_col) == 1 && trg_row == src_row + direction) {
-		auto target_pawn = board->getPiece(src_row, trg_col);
-		if (target_pawn && target_pawn->getType() == PieceType::Pawn && target_pawn->getColor() != getColor()) {
-			// Ensure the target pawn just moved two squares in the last turn
-			Move move = board->getLastMove();
-			if (isDoubleStep(move)) {
-				return true;
-			}
-		}
+		return board.getSideToMove() == getColor() && board.getEnPassantSquare() == makeSquare(trg_row, trg_col);
 	}
 
 	return false;
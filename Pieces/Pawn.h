@@ -8,8 +8,8 @@ public:
     {
     };
 
-    bool isValidMove(int src_row, int src_col, int trg_row, int trg_col) const override;
-    bool isEnPassant(int src_row, int src_col, int trg_row, int trg_col) const;
+    bool isValidMove(const Board& board, int src_row, int src_col, int trg_row, int trg_col) const override;
+    bool isEnPassant(const Board& board, int src_row, int src_col, int trg_row, int trg_col) const;
 
     std::string getImagePath() const override;
 };
@@ -5,34 +5,54 @@
 #include <vector>
 #include <memory>
 
-struct Move;
+class Board;
 
 enum class PieceType {Empty, Pawn, Knight, Bishop, Rook, Queen, King};
 enum class PieceColor {Blank, White, Black};
 
+constexpr PieceColor oppositeColor(PieceColor color)
+{
+	return (color == PieceColor::White) ? PieceColor::Black : PieceColor::White;
+}
+
 class Piece
 {
 public:
 	Piece(PieceColor col = PieceColor::Blank, PieceType type = PieceType::Empty)
 		: m_type{ type }, m_color {col}
 	{
-		m_hasMoved = false;
 	};
 
 	const PieceColor& getColor() const { return m_color; };
 	const PieceType& getType() const { return m_type; };
-	const bool& hasMoved() const { return m_hasMoved; } ;
-	void setMoved(bool val) { m_hasMoved = val; };
-	void setType(PieceType type) { m_type = type; };
-	virtual bool isValidMove(int src_row, int src_col, int trg_row, int trg_col) const { return false; };
+	virtual bool isValidMove(const Board&, int, int, int, int) const { return false; };
 	virtual std::string getImagePath() const { return ""; };
-	void getValidMoves(int row, int col, std::vector<Move> &moves);
-	int getValue() const;
+	int getValue() const { return getValue(m_type); };
+	static constexpr int getValue(PieceType type);
 
 private:
 	PieceType m_type;
 	PieceColor m_color;
-	bool m_hasMoved;
 };
 
+constexpr int Piece::getValue(PieceType type)
+{
+    switch (type)
+    {
+    case PieceType::Pawn:
+        return 100;
+    case PieceType::Knight:
+        return 300;
+    case PieceType::Bishop:
+        return 325;
+    case PieceType::Rook:
+        return 500;
+    case PieceType::Queen:
+        return 900;
+    case PieceType::King:
+        return 10000; // Use a high value for King; this value is just an example
+    default:
+        return 0; // For PieceType::Empty or unknown types
+    }
+}
 
@@ -3,53 +3,15 @@
 #include <array>
 #include "Board.h"
 
-bool Queen::isValidMove(int src_row, int src_col, int trg_row, int trg_col) const
+bool Queen::isValidMove(const Board& board, int src_row, int src_col, int trg_row, int trg_col) const
 {
-    std::shared_ptr<Board> board = getBoard();
+    int src = makeSquare(src_row, src_col);
+    int trg = makeSquare(trg_row, trg_col);
 
-    if (src_row == trg_row && src_col == trg_col) {
-        return false;
-    }
-
-    // Check if the queen is moving horizontally, vertically, or diagonally
-    if (src_row == trg_row || src_col == trg_col || std::abs(trg_row - src_row) == std::abs(trg_col - src_col)) {
-        // Check if the path is clear
-        if (isPathClear(src_row, src_col, trg_row, trg_col)) {
-            // Check if the target piece is empty or contains an opponent's piece
-            std::shared_ptr<Piece> trg_piece = board->getPiece(trg_row, trg_col);
-            if (!trg_piece || trg_piece->getColor() != this->getColor()) {
-                return true;
-            }
-        }
-    }
-
-    return false;
-}
-
-bool Queen::isPathClear(int src_row, int src_col, int trg_row, int trg_col) const
-{
-    std::shared_ptr<Board> board = getBoard();
-
-    // Determine the direction of movement
-    int row_direction = (trg_row > src_row) ? 1 : (trg_row < src_row) ? -1 : 0;
-    int col_direction = (trg_col > src_col) ? 1 : (trg_col < src_col) ? -1 : 0;
-
-    // Check if the queen is moving horizontally, vertically, or diagonally
-    if (src_row == trg_row || src_col == trg_col || std::abs(trg_row - src_row) == std::abs(trg_col - src_col)) {
-        int row = src_row + row_direction;
-        int col = src_col + col_direction;
-
-        // Iterate over the squares along the path
-        while (row != trg_row || col != trg_col) {
-            if (board->getPiece(row, col)) {
-                return false; // Path is pieceed
-            }
-            row += row_direction;
-            col += col_direction;
-        }
-    }
-
-    return true; // Path is clear
+    // The queen combines the rook and bishop rays
+    Bitboard occupied = board.occupied();
+    Bitboard attacks = rookAttacks(src, occupied) | bishopAttacks(src, occupied);
+    return (attacks & ~board.pieces(getColor()) & squareBB(trg)) != 0;
 }
 
 std::string Queen::getImagePath() const
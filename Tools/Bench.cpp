@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Board.h"
+#include "Search.h"
+
+// Middlegame positions with enough going on that every thread finds work
+static const char* benchPositions[] = {
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+	"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+	"r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+	"r2q1rk1/pp2bppp/2n1pn2/3p4/3P4/2NBPN2/PP3PPP/R2Q1RK1 b - - 0 10",
+};
+
+// Tactical positions from Win at Chess with their solutions in coordinate notation
+struct Tactic {
+	const char* fen;
+	const char* best;
+};
+
+static const Tactic tactics[] = {
+	{ "2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - 0 1", "g3g6" },
+	{ "8/7p/5k2/5p2/p1p2P2/Pr1pPK2/1P1R3P/8 b - - 0 1", "b3b2" },
+	{ "5rk1/1ppb3p/p1pb4/6q1/3P1p1r/2P1R2P/PP1BQ1P1/5RKN w - - 0 1", "e3g3" },
+	{ "r1bq2rk/pp3pbp/2p1p1pQ/7P/3P4/2PB1N2/PP3PPR/2KR4 w - - 0 1", "h6h7" },
+	{ "5k2/6pp/p1qN4/1p1p4/3P4/2PKP2Q/PP3r2/3R4 b - - 0 1", "c6c4" },
+	{ "7k/p7/1R5K/6r1/6p1/6P1/8/8 w - - 0 1", "b6b7" },
+	{ "rnbqkb1r/pppp1ppp/8/4P3/6n1/7P/PPPNPPP1/R1BQKBNR b KQkq - 0 1", "g4e3" },
+	{ "r4q1k/p2bR1rp/2p2Q1N/5p2/5p2/2P5/PP3PPP/R5K1 w - - 0 1", "e7f7" },
+	{ "3q1rk1/p4pp1/2pb3p/3p4/6Pr/1PNQ4/P1PB1PP1/4RRK1 b - - 0 1", "d6h2" },
+	{ "2br2k1/2q3rn/p2NppQ1/2p1P3/Pp5R/4P3/1P3PPP/3R2K1 w - - 0 1", "h4h7" },
+};
+
+struct BenchResult {
+	int threads;
+	double seconds;
+	uint64_t nodes;
+	uint64_t qnodes;
+	uint64_t cutoffs;
+	uint64_t firstMoveCutoffs;
+	uint64_t evaluations;
+	uint64_t pawnProbes;
+	uint64_t pawnHits;
+};
+
+static BenchResult runBench(Search& search, int threads, int depth)
+{
+	BenchResult result{ threads, 0, 0, 0, 0, 0, 0, 0, 0 };
+	search.setThreads(threads);
+
+	for (const char* fen : benchPositions) {
+		// Every position starts from an empty table so thread counts are compared fairly
+		Board board;
+		board.loadFen(fen);
+		search.clearHash();
+		search.findBestMove(board, depth);
+
+		const SearchStats& stats = search.getLastStats();
+		result.seconds += stats.seconds;
+		result.nodes += stats.nodes;
+		result.qnodes += stats.qnodes;
+		result.cutoffs += stats.cutoffs;
+		result.firstMoveCutoffs += stats.firstMoveCutoffs;
+		result.evaluations += stats.evaluations;
+		result.pawnProbes += stats.pawnProbes;
+		result.pawnHits += stats.pawnHits;
+	}
+
+	return result;
+}
+
+// Runs the bench positions and the tactics once per selective search setting, so
+// the nodes each part saves can be weighed against the solutions it misses
+static void runSelectiveBench(Search& search, int depth)
+{
+	struct Setting {
+		const char* name;
+		SearchOptions options;
+	};
+	const Setting settings[] = {
+		{ "all on", { true, true, true } },
+		{ "no null move", { false, true, true } },
+		{ "no LMR", { true, false, true } },
+		{ "no futility", { true, true, false } },
+		{ "all off", { false, false, false } },
+	};
+
+	std::cout << std::setw(14) << "setting" << std::setw(16) << "time-to-depth" << std::setw(14) << "nodes"
+		<< std::setw(10) << "tactics" << std::endl;
+
+	for (const Setting& setting : settings) {
+		search.setOptions(setting.options);
+		BenchResult result = runBench(search, 1, depth);
+
+		int solved = 0;
+		for (const Tactic& tactic : tactics) {
+			Board board;
+			board.loadFen(tactic.fen);
+			search.clearHash();
+			if (moveToString(search.findBestMove(board, depth)) == tactic.best) {
+				solved++;
+			}
+		}
+
+		std::cout << std::setw(14) << setting.name
+			<< std::setw(14) << std::fixed << std::setprecision(3) << result.seconds << " s"
+			<< std::setw(14) << result.nodes
+			<< std::setw(7) << solved << "/" << std::size(tactics) << std::endl;
+	}
+
+	search.setOptions(SearchOptions{});
+}
+
+static std::vector<int> parseThreadList(const std::string& text)
+{
+	std::vector<int> threads;
+	std::stringstream stream(text);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		int count = std::atoi(item.c_str());
+		if (count > 0) {
+			threads.push_back(count);
+		}
+	}
+	return threads;
+}
+
+int main(int argc, char* argv[])
+{
+	int depth = 4;
+	std::vector<int> threads;
+	bool selective = false;
+	Search search;
+	std::unique_ptr<NnueNetwork> network;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--depth" && i + 1 < argc) {
+			depth = std::atoi(argv[++i]);
+		} else if (arg == "--threads" && i + 1 < argc) {
+			threads = parseThreadList(argv[++i]);
+		} else if (arg == "--hash" && i + 1 < argc) {
+			search.setHashSize(std::atoi(argv[++i]));
+		} else if (arg == "--selective") {
+			selective = true;
+		} else if (arg == "--nnue" && i + 1 < argc) {
+			network = std::make_unique<NnueNetwork>();
+			if (!network->load(argv[++i])) {
+				std::cout << "Cannot load network " << argv[i] << std::endl;
+				return 1;
+			}
+			search.setNetwork(network.get());
+		} else {
+			std::cout << "Usage: OpenChess_bench [--depth N] [--threads 1,2,4] [--hash MB] [--selective] [--nnue FILE]" << std::endl;
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+
+	// By default double the thread count up to the number of cores
+	if (threads.empty()) {
+		int cores = std::max(1u, std::thread::hardware_concurrency());
+		for (int count = 1; count < cores; count *= 2) {
+			threads.push_back(count);
+		}
+		threads.push_back(cores);
+	}
+
+	std::cout << "Depth " << depth << ", " << std::size(benchPositions) << " positions, hash " << search.getHashSize() << " MB, evaluation "
+		<< (network ? std::string("NNUE (") + NnueNetwork::kernelName() + ")" : std::string("piece-square")) << std::endl;
+	if (selective) {
+		runSelectiveBench(search, depth);
+		return 0;
+	}
+
+	std::cout << std::setw(8) << "threads" << std::setw(16) << "time-to-depth" << std::setw(14) << "nodes"
+		<< std::setw(8) << "qnodes" << std::setw(10) << "1st-cut" << std::setw(10) << "pawn-hit" << std::setw(12) << "nps" << std::setw(12) << "evals/s" << std::setw(10) << "speedup" << std::endl;
+
+	double baseline = 0;
+	for (int count : threads) {
+		BenchResult result = runBench(search, count, depth);
+		if (baseline == 0) {
+			baseline = result.seconds;
+		}
+
+		uint64_t nps = result.seconds > 0 ? static_cast<uint64_t>(result.nodes / result.seconds) : 0;
+		uint64_t eps = result.seconds > 0 ? static_cast<uint64_t>(result.evaluations / result.seconds) : 0;
+		std::cout << std::setw(8) << result.threads
+			<< std::setw(14) << std::fixed << std::setprecision(3) << result.seconds << " s"
+			<< std::setw(14) << result.nodes
+			<< std::setw(7) << (result.nodes ? 100 * result.qnodes / result.nodes : 0) << "%"
+			<< std::setw(9) << (result.cutoffs ? 100 * result.firstMoveCutoffs / result.cutoffs : 0) << "%"
+			<< std::setw(9) << (result.pawnProbes ? 100 * result.pawnHits / result.pawnProbes : 0) << "%"
+			<< std::setw(12) << nps
+			<< std::setw(12) << eps
+			<< std::setw(9) << std::setprecision(2) << (result.seconds > 0 ? baseline / result.seconds : 0) << "x" << std::endl;
+	}
+
+	return 0;
+}
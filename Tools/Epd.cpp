@@ -0,0 +1,332 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Board.h"
+#include "Search.h"
+
+// Runs EPD test suites: each position is searched under the same budget and the
+// move found is checked against its bm (best move) or am (avoid move) operations.
+// Positions are shared out to a pool of workers, each with its own Search.
+
+struct EpdPosition {
+	std::string id;
+	std::string fen;
+	std::vector<Move> best;  // bm, any of them solves
+	std::vector<Move> avoid; // am, none of them may be played
+	std::string expected;    // the operations as written, for the report
+};
+
+struct EpdResult {
+	Move move;
+	bool solved = false;
+	int depth = 0;
+	uint64_t nodes = 0;
+	double seconds = 0;
+	// When the search settled on a solving move for good, or -1 when it never did
+	int64_t solutionMs = -1;
+	uint64_t solutionNodes = 0;
+};
+
+// Over the whole suite. The search time adds up the time of every search, so with
+// several jobs at once it exceeds the wall-clock time the suite took.
+struct EpdTotals {
+	int solved = 0;
+	int64_t averageMs = 0; // time to solution, over the solved positions
+	uint64_t nodes = 0;
+	double searchSeconds = 0;
+	double wallSeconds = 0;
+	int jobs = 0;
+};
+
+static bool isSolution(const EpdPosition& position, const Move& move)
+{
+	if (!position.best.empty() && std::find(position.best.begin(), position.best.end(), move) == position.best.end()) {
+		return false;
+	}
+	return std::find(position.avoid.begin(), position.avoid.end(), move) == position.avoid.end();
+}
+
+// FEN fields, then operations "opcode operand ...;". Moves are SAN, or coordinate
+// notation as some suites use.
+static bool parseEpd(const std::string& line, EpdPosition& position)
+{
+	std::istringstream stream(line);
+	std::string fields[4];
+	for (std::string& field : fields) {
+		if (!(stream >> field)) {
+			return false;
+		}
+	}
+	position.fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3];
+
+	Board board;
+	if (!board.loadFen(position.fen)) {
+		return false;
+	}
+
+	std::string rest;
+	std::getline(stream, rest);
+	std::istringstream operations(rest);
+	std::string operation;
+	while (std::getline(operations, operation, ';')) {
+		std::istringstream words(operation);
+		std::string opcode, operand;
+		words >> opcode;
+		if (opcode == "id") {
+			std::getline(words >> std::ws, operand);
+			position.id = operand.size() >= 2 && operand.front() == '"' ? operand.substr(1, operand.size() - 2) : operand;
+		} else if (opcode == "bm" || opcode == "am") {
+			std::vector<Move>& moves = (opcode == "bm") ? position.best : position.avoid;
+			while (words >> operand) {
+				Move move;
+				if (!board.parseSan(operand, move) && !board.parseMove(operand, move)) {
+					return false;
+				}
+				moves.push_back(move);
+			}
+			position.expected += (position.expected.empty() ? "" : "; ") + operation.substr(operation.find_first_not_of(' '));
+		}
+	}
+	return !position.best.empty() || !position.avoid.empty();
+}
+
+static void solve(Search& search, const EpdPosition& position, const SearchLimits& limits, EpdResult& result)
+{
+	// The iteration from which every later one played a solving move
+	struct Iteration {
+		int64_t timeMs;
+		uint64_t nodes;
+		bool solved;
+	};
+	std::vector<Iteration> iterations;
+	search.setInfoCallback([&](const SearchInfo& info) {
+		iterations.push_back({ info.timeMs, info.nodes, !info.pv.empty() && isSolution(position, info.pv[0]) });
+	});
+
+	Board board;
+	board.loadFen(position.fen);
+	search.clearHash();
+	result.move = search.findBestMove(board, limits);
+	search.setInfoCallback(nullptr);
+
+	const SearchStats& stats = search.getLastStats();
+	result.solved = result.move.isValid() && isSolution(position, result.move);
+	result.depth = stats.depth;
+	result.nodes = stats.nodes;
+	result.seconds = stats.seconds;
+	if (result.solved) {
+		for (size_t i = iterations.size(); i > 0 && iterations[i - 1].solved; --i) {
+			result.solutionMs = iterations[i - 1].timeMs;
+			result.solutionNodes = iterations[i - 1].nodes;
+		}
+	}
+}
+
+static std::string jsonString(const std::string& text)
+{
+	std::string out = "\"";
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			out += '\\';
+		}
+		out += c;
+	}
+	return out + "\"";
+}
+
+static std::string csvString(const std::string& text)
+{
+	std::string out = "\"";
+	for (char c : text) {
+		out += (c == '"') ? "\"\"" : std::string(1, c);
+	}
+	return out + "\"";
+}
+
+static uint64_t perSecond(uint64_t count, double seconds)
+{
+	return seconds > 0 ? static_cast<uint64_t>(count / seconds) : 0;
+}
+
+static void printText(const std::vector<EpdPosition>& positions, const std::vector<EpdResult>& results)
+{
+	std::cout << std::left << std::setw(16) << "id" << std::right << std::setw(8) << "result" << std::setw(8) << "move"
+		<< std::setw(7) << "depth" << std::setw(10) << "solved-ms" << std::setw(12) << "nodes" << std::setw(12) << "nps"
+		<< "  expected" << std::endl;
+	for (size_t i = 0; i < positions.size(); ++i) {
+		const EpdResult& result = results[i];
+		std::cout << std::left << std::setw(16) << positions[i].id << std::right << std::setw(8) << (result.solved ? "ok" : "FAIL")
+			<< std::setw(8) << moveToString(result.move) << std::setw(7) << result.depth
+			<< std::setw(10) << (result.solutionMs >= 0 ? std::to_string(result.solutionMs) : "-")
+			<< std::setw(12) << result.nodes << std::setw(12) << perSecond(result.nodes, result.seconds)
+			<< "  " << positions[i].expected << std::endl;
+	}
+}
+
+static void printTotals(const std::vector<EpdPosition>& positions, const EpdTotals& totals)
+{
+	std::cout << "Solved " << totals.solved << "/" << positions.size() << ", average time to solution " << totals.averageMs
+		<< " ms, " << totals.nodes << " nodes" << std::fixed << std::setprecision(3)
+		<< "\nSearch time " << totals.searchSeconds << " s summed over searches, " << perSecond(totals.nodes, totals.searchSeconds) << " nps"
+		<< "\nWall clock " << totals.wallSeconds << " s with " << totals.jobs << " jobs, " << perSecond(totals.nodes, totals.wallSeconds)
+		<< " nps" << std::endl;
+}
+
+// Ends with a "total" row: the number solved, their average time to solution, the
+// nodes, and time and speed both summed over the searches and by the wall clock
+static void printCsv(const std::vector<EpdPosition>& positions, const std::vector<EpdResult>& results, const EpdTotals& totals)
+{
+	std::cout << "id,solved,move,depth,solution_ms,solution_nodes,nodes,search_seconds,search_nps,wall_seconds,wall_nps" << std::endl;
+	for (size_t i = 0; i < positions.size(); ++i) {
+		const EpdResult& result = results[i];
+		std::cout << csvString(positions[i].id) << "," << (result.solved ? 1 : 0) << "," << moveToString(result.move) << ","
+			<< result.depth << "," << result.solutionMs << "," << result.solutionNodes << "," << result.nodes << ","
+			<< result.seconds << "," << perSecond(result.nodes, result.seconds) << ",," << std::endl;
+	}
+	std::cout << "total," << totals.solved << ",,," << totals.averageMs << ",," << totals.nodes << "," << totals.searchSeconds << ","
+		<< perSecond(totals.nodes, totals.searchSeconds) << "," << totals.wallSeconds << "," << perSecond(totals.nodes, totals.wallSeconds)
+		<< std::endl;
+}
+
+static void printJson(const std::vector<EpdPosition>& positions, const std::vector<EpdResult>& results, const EpdTotals& totals)
+{
+	std::cout << "{\n  \"positions\": [\n";
+	for (size_t i = 0; i < positions.size(); ++i) {
+		const EpdResult& result = results[i];
+		std::cout << "    { \"id\": " << jsonString(positions[i].id) << ", \"solved\": " << (result.solved ? "true" : "false")
+			<< ", \"move\": \"" << moveToString(result.move) << "\", \"depth\": " << result.depth
+			<< ", \"solution_ms\": " << result.solutionMs << ", \"solution_nodes\": " << result.solutionNodes
+			<< ", \"nodes\": " << result.nodes << ", \"seconds\": " << result.seconds
+			<< ", \"nps\": " << perSecond(result.nodes, result.seconds) << " }" << (i + 1 < positions.size() ? "," : "") << "\n";
+	}
+	std::cout << "  ],\n  \"solved\": " << totals.solved << ", \"total\": " << positions.size()
+		<< ", \"average_solution_ms\": " << totals.averageMs << ", \"nodes\": " << totals.nodes
+		<< ",\n  \"search_seconds\": " << totals.searchSeconds << ", \"search_nps\": " << perSecond(totals.nodes, totals.searchSeconds)
+		<< ", \"wall_seconds\": " << totals.wallSeconds << ", \"wall_nps\": " << perSecond(totals.nodes, totals.wallSeconds)
+		<< ", \"jobs\": " << totals.jobs << "\n}" << std::endl;
+}
+
+static void printUsage()
+{
+	std::cout << "Usage: OpenChess_epd [options] <suite.epd>\n"
+		<< "  --movetime MS       time per position (default 1000)\n"
+		<< "  --nodes N           node budget per position instead\n"
+		<< "  --depth N           depth per position instead\n"
+		<< "  --jobs N            positions searched at the same time (default: cores)\n"
+		<< "  --threads N         search threads per position (default 1)\n"
+		<< "  --hash MB           table size of each job\n"
+		<< "  --format F          text, csv or json (default text)\n";
+}
+
+int main(int argc, char* argv[])
+{
+	SearchLimits limits;
+	int jobs = std::max(1u, std::thread::hardware_concurrency());
+	int threads = 1;
+	int hash = 16;
+	std::string format = "text", path;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--movetime" && i + 1 < argc) {
+			limits.moveTimeMs = std::atoi(argv[++i]);
+		} else if (arg == "--nodes" && i + 1 < argc) {
+			limits.nodes = std::strtoull(argv[++i], nullptr, 10);
+		} else if (arg == "--depth" && i + 1 < argc) {
+			limits.depth = std::atoi(argv[++i]);
+		} else if (arg == "--jobs" && i + 1 < argc) {
+			jobs = std::max(1, std::atoi(argv[++i]));
+		} else if (arg == "--threads" && i + 1 < argc) {
+			threads = std::max(1, std::atoi(argv[++i]));
+		} else if (arg == "--hash" && i + 1 < argc) {
+			hash = std::max(1, std::atoi(argv[++i]));
+		} else if (arg == "--format" && i + 1 < argc) {
+			format = argv[++i];
+		} else if (path.empty() && arg[0] != '-') {
+			path = arg;
+		} else {
+			printUsage();
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+	if (path.empty() || (format != "text" && format != "csv" && format != "json")) {
+		printUsage();
+		return 1;
+	}
+	if (!limits.moveTimeMs && !limits.nodes && !limits.depth) {
+		limits.moveTimeMs = 1000;
+	}
+
+	std::ifstream file(path);
+	if (!file) {
+		std::cerr << "Cannot open " << path << std::endl;
+		return 1;
+	}
+	std::vector<EpdPosition> positions;
+	std::string line;
+	for (int number = 1; std::getline(file, line); ++number) {
+		if (line.find_first_not_of(" \t\r") == std::string::npos || line[0] == '#') {
+			continue;
+		}
+		EpdPosition position;
+		if (!parseEpd(line, position)) {
+			std::cerr << path << ":" << number << ": skipped, cannot parse" << std::endl;
+			continue;
+		}
+		if (position.id.empty()) {
+			position.id = "line " + std::to_string(number);
+		}
+		positions.push_back(position);
+	}
+
+	// Every job takes the next position until none are left
+	std::vector<EpdResult> results(positions.size());
+	std::atomic<size_t> next{ 0 };
+	std::vector<std::thread> pool;
+	jobs = std::min<int>(jobs, static_cast<int>(positions.size()));
+	auto start = std::chrono::steady_clock::now();
+	for (int j = 0; j < jobs; ++j) {
+		pool.emplace_back([&]() {
+			Search search(hash);
+			search.setThreads(threads);
+			for (size_t i = next++; i < positions.size(); i = next++) {
+				solve(search, positions[i], limits, results[i]);
+			}
+		});
+	}
+	for (std::thread& worker : pool) {
+		worker.join();
+	}
+
+	EpdTotals totals;
+	std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+	totals.wallSeconds = wall.count();
+	totals.jobs = jobs;
+	int64_t solution_ms = 0;
+	for (const EpdResult& result : results) {
+		totals.solved += result.solved;
+		totals.nodes += result.nodes;
+		totals.searchSeconds += result.seconds;
+		solution_ms += result.solved ? result.solutionMs : 0;
+	}
+	totals.averageMs = totals.solved ? solution_ms / totals.solved : 0;
+
+	if (format == "csv") {
+		printCsv(positions, results, totals);
+	} else if (format == "json") {
+		printJson(positions, results, totals);
+	} else {
+		printText(positions, results);
+		printTotals(positions, totals);
+	}
+	return 0;
+}
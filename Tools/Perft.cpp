@@ -0,0 +1,253 @@
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Board.h"
+
+struct PerftReference {
+	const char* name;
+	const char* fen;
+	std::vector<uint64_t> nodes; // expected node count for depth 1, 2, ...
+};
+
+// Standard move generator test positions with their published node counts
+static const std::vector<PerftReference> references = {
+	{ "startpos", START_FEN,
+		{ 20, 400, 8902, 197281, 4865609, 119060324 } },
+	{ "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		{ 48, 2039, 97862, 4085603, 193690690 } },
+	{ "position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+		{ 14, 191, 2812, 43238, 674624, 11030083 } },
+	{ "position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+		{ 6, 264, 9467, 422333, 15833292 } },
+	{ "position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+		{ 44, 1486, 62379, 2103487, 89941194 } },
+	{ "position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+		{ 46, 2079, 89890, 3894594, 164075551 } },
+};
+
+static uint64_t perft(Board& board, int depth)
+{
+	if (depth == 0) {
+		return 1;
+	}
+
+	MoveList moves = board.getLegalMoves();
+
+	// Bulk count at the last ply, the moves are already known to be legal
+	if (depth == 1) {
+		return moves.size();
+	}
+
+	uint64_t nodes = 0;
+	for (const Move& move : moves) {
+		board.makeMove(move);
+		nodes += perft(board, depth - 1);
+		board.undoMove(move);
+	}
+	return nodes;
+}
+
+static uint64_t divide(Board& board, int depth)
+{
+	uint64_t nodes = 0;
+	for (const Move& move : board.getLegalMoves()) {
+		board.makeMove(move);
+		uint64_t count = (depth > 1) ? perft(board, depth - 1) : 1;
+		board.undoMove(move);
+
+		std::cout << moveToString(move) << ": " << count << std::endl;
+		nodes += count;
+	}
+	return nodes;
+}
+
+static double elapsedSeconds(std::chrono::steady_clock::time_point start)
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+static void printStats(uint64_t nodes, double seconds)
+{
+	uint64_t nps = (seconds > 0) ? static_cast<uint64_t>(nodes / seconds) : 0;
+	std::cout << "Nodes: " << nodes << "  Time: " << static_cast<int>(seconds * 1000) << " ms  NPS: " << nps << std::endl;
+}
+
+// FENs loadFen() must reject, each with what is wrong with it
+static const std::pair<const char*, const char*> invalidFens[] = {
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBN w KQkq - 0 1", "short rank" },
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNRR w KQkq - 0 1", "long rank" },
+	{ "rnbqkbnr/pppppppp/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "seven ranks" },
+	{ "rnbqkbnr/pppppppp/8/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "nine ranks" },
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQQBNR w kq - 0 1", "no white king" },
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBKKBNR w kq - 0 1", "two white kings" },
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNP w Qkq - 0 1", "pawn on the first rank" },
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1", "bad side" },
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR KQkq - 0 1", "missing side" },
+	{ "rnb1kbnr/pppp1ppp/8/4p3/7q/5P2/PPPPP1PP/RNBQKBNR b KQkq - 1 3", "side not to move in check" },
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkx - 0 1", "bad castling letter" },
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KKkq - 0 1", "repeated castling right" },
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBN1 w KQkq - 0 1", "castling without the rook" },
+	{ "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e6 0 1", "en passant on the wrong rank" },
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e6 0 1", "en passant without the pawn" },
+	{ "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e9 0 1", "bad en passant square" },
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - x 1", "bad halfmove clock" },
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 2", "extra field" },
+	{ "", "empty" },
+};
+
+// Every reference position and each position one move from it must come back
+// unchanged from getFen() and loadFen(). Invalid FENs must be rejected and leave
+// the board as it was.
+static int verifyFen()
+{
+	int failures = 0;
+	for (const auto& [fen, reason] : invalidFens) {
+		Board board;
+		board.loadFen(references[1].fen);
+		std::string before = board.getFen();
+		uint64_t key = board.getKey();
+		if (board.loadFen(fen) || board.getFen() != before || board.getKey() != key) {
+			std::cout << "Invalid FEN (" << reason << ") FAILED: " << fen << std::endl;
+			failures++;
+		}
+	}
+
+	for (const PerftReference& ref : references) {
+		Board board;
+		board.loadFen(ref.fen);
+		if (board.getFen() != ref.fen) {
+			std::cout << ref.name << " FEN: " << board.getFen() << " FAILED (expected " << ref.fen << ")" << std::endl;
+			failures++;
+		}
+
+		for (const Move& move : board.getLegalMoves()) {
+			board.makeMove(move);
+			Board loaded;
+			loaded.loadFen(board.getFen());
+			if (loaded.getFen() != board.getFen() || loaded.getKey() != board.getKey()) {
+				std::cout << ref.name << " FEN after " << moveToString(move) << ": " << board.getFen() << " FAILED" << std::endl;
+				failures++;
+			}
+			board.undoMove(move);
+		}
+	}
+
+	// Load throughput, cycling through the reference positions
+	constexpr int LOADS = 1000000;
+	Board board;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < LOADS; ++i) {
+		board.loadFen(references[i % references.size()].fen);
+	}
+	double seconds = elapsedSeconds(start);
+	std::cout << "FEN round trips " << (failures ? "FAILED" : "OK") << ", " << static_cast<uint64_t>(seconds > 0 ? LOADS / seconds : 0)
+		<< " loads per second" << std::endl;
+	return failures;
+}
+
+static int verify(int max_depth)
+{
+	int failures = 0;
+	uint64_t total_nodes = 0;
+	auto total_start = std::chrono::steady_clock::now();
+
+	for (const PerftReference& ref : references) {
+		Board board;
+		board.loadFen(ref.fen);
+
+		for (int depth = 1; depth <= max_depth && depth <= static_cast<int>(ref.nodes.size()); ++depth) {
+			auto start = std::chrono::steady_clock::now();
+			uint64_t nodes = perft(board, depth);
+			double seconds = elapsedSeconds(start);
+			uint64_t expected = ref.nodes[depth - 1];
+			total_nodes += nodes;
+
+			std::cout << ref.name << " depth " << depth << ": " << nodes;
+			if (nodes == expected) {
+				std::cout << " OK";
+			} else {
+				std::cout << " FAILED (expected " << expected << ")";
+				failures++;
+			}
+			std::cout << "  " << static_cast<uint64_t>(seconds > 0 ? nodes / seconds : 0) << " nps" << std::endl;
+		}
+	}
+
+	printStats(total_nodes, elapsedSeconds(total_start));
+	failures += verifyFen();
+	std::cout << (failures ? "Perft verification FAILED" : "Perft verification passed") << std::endl;
+	return failures ? 1 : 0;
+}
+
+static void printUsage()
+{
+	std::cout << "Usage: OpenChess_perft [options] <depth>\n"
+		<< "  --fen \"<fen>\"       start from this position instead of the initial one\n"
+		<< "  --moves <m1> <m2>   play these moves (e.g. e2e4 e7e5) before counting\n"
+		<< "  --divide            print the node count below each root move\n"
+		<< "  --verify [depth]    check the reference positions up to depth (default 4)\n"
+		<< "  --verify-fen        only check the FEN round trips\n";
+}
+
+int main(int argc, char* argv[])
+{
+	std::string fen = START_FEN;
+	std::vector<std::string> moves;
+	bool show_divide = false;
+	int depth = -1;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+
+		if (arg == "--verify") {
+			int max_depth = (i + 1 < argc) ? std::atoi(argv[i + 1]) : 0;
+			return verify(max_depth > 0 ? max_depth : 4);
+		} else if (arg == "--verify-fen") {
+			return verifyFen() ? 1 : 0;
+		} else if (arg == "--fen" && i + 1 < argc) {
+			fen = argv[++i];
+		} else if (arg == "--moves") {
+			while (i + 1 < argc && std::isalpha(static_cast<unsigned char>(argv[i + 1][0]))) {
+				moves.push_back(argv[++i]);
+			}
+		} else if (arg == "--divide") {
+			show_divide = true;
+		} else if (arg == "--help" || arg == "-h") {
+			printUsage();
+			return 0;
+		} else {
+			depth = std::atoi(arg.c_str());
+		}
+	}
+
+	if (depth < 1) {
+		printUsage();
+		return 1;
+	}
+
+	Board board;
+	if (!board.loadFen(fen)) {
+		std::cerr << "Invalid FEN: " << fen << std::endl;
+		return 1;
+	}
+
+	for (const std::string& text : moves) {
+		Move move;
+		if (!board.parseMove(text, move)) {
+			std::cerr << "Illegal move: " << text << std::endl;
+			return 1;
+		}
+		board.makeMove(move);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	uint64_t nodes = show_divide ? divide(board, depth) : perft(board, depth);
+	printStats(nodes, elapsedSeconds(start));
+	return 0;
+}
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Board.h"
+#include "Pgn.h"
+
+// Replays every game of a PGN archive through the move rules, on as many threads
+// as asked for, and optionally prints the position before each move as a FEN.
+// The archive is cut into chunks of about CHUNK_BYTES that the threads take in
+// turn; finished chunks are printed in file order and freed, and no thread runs
+// more than a few chunks ahead of the printing, so memory stays bounded however
+// large the archive is.
+
+constexpr size_t CHUNK_BYTES = 1 << 20;
+
+struct PartResult {
+	uint64_t games = 0;
+	uint64_t positions = 0;
+	std::string output; // positions in file order
+	std::vector<std::pair<uint64_t, std::string>> errors; // by game number within the part
+	bool done = false;
+};
+
+static void replayPart(std::string_view text, bool fens, PartResult& result)
+{
+	PgnReader reader(text);
+	PgnGame game;
+	Board board;
+	char fen[FEN_MAX_LENGTH];
+	std::string error;
+
+	while (reader.next(game)) {
+		result.games++;
+		auto visit = [&](const Board& position, const Move&) {
+			result.positions++;
+			if (fens) {
+				result.output.append(fen, position.writeFen(fen));
+				result.output += '\n';
+			}
+		};
+		if (!replayPgn(game, board, visit, &error)) {
+			std::string_view white = game.tag("White"), black = game.tag("Black");
+			std::string message = "(";
+			message.append(white).append(" - ").append(black).append("): ").append(error);
+			result.errors.emplace_back(result.games, std::move(message));
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string path;
+	bool fens = false;
+	int threads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--threads" && i + 1 < argc) {
+			threads = std::max(1, std::atoi(argv[++i]));
+		} else if (arg == "--fens") {
+			fens = true;
+		} else if (path.empty() && arg[0] != '-') {
+			path = arg;
+		} else {
+			std::cout << "Usage: OpenChess_pgn [--threads N] [--fens] <file.pgn>" << std::endl;
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+	if (path.empty()) {
+		std::cout << "Usage: OpenChess_pgn [--threads N] [--fens] <file.pgn>" << std::endl;
+		return 1;
+	}
+
+	MappedFile file;
+	if (!file.open(path)) {
+		std::cerr << "Cannot open " << path << std::endl;
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	int chunks = static_cast<int>(std::max<size_t>(threads, file.view().size() / CHUNK_BYTES + 1));
+	std::vector<std::string_view> parts = splitPgn(file.view(), chunks);
+	std::vector<PartResult> results(parts.size());
+	const size_t window = 2 * static_cast<size_t>(threads);
+	std::atomic<size_t> next{ 0 };
+	size_t printed = 0;
+	std::mutex mutex;
+	std::condition_variable changed;
+
+	std::vector<std::thread> workers;
+	for (int t = 0; t < std::min<int>(threads, static_cast<int>(parts.size())); ++t) {
+		workers.emplace_back([&]() {
+			for (size_t i = next++; i < parts.size(); i = next++) {
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					changed.wait(lock, [&]() { return i < printed + window; });
+				}
+				PartResult result;
+				replayPart(parts[i], fens, result);
+				std::lock_guard<std::mutex> lock(mutex);
+				results[i] = std::move(result);
+				results[i].done = true;
+				changed.notify_all();
+			}
+		});
+	}
+
+	uint64_t games = 0, positions = 0, errors = 0;
+	for (size_t i = 0; i < parts.size(); ++i) {
+		PartResult result;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&]() { return results[i].done; });
+			result = std::move(results[i]);
+			results[i] = PartResult();
+		}
+		std::cout << result.output;
+		for (const auto& error : result.errors) {
+			std::cerr << "Game " << games + error.first << " " << error.second << std::endl;
+		}
+		games += result.games;
+		positions += result.positions;
+		errors += result.errors.size();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		printed = i + 1;
+		changed.notify_all();
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	double seconds = elapsed.count();
+	std::cerr << games << " games, " << positions << " positions, " << errors << " with errors, "
+		<< workers.size() << " threads, " << static_cast<int>(seconds * 1000) << " ms, "
+		<< static_cast<uint64_t>(seconds > 0 ? games / seconds : 0) << " games/s" << std::endl;
+	return errors ? 1 : 0;
+}
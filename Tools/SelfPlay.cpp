@@ -0,0 +1,758 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Board.h"
+#include "Pgn.h"
+#include "Search.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Plays two engines against each other, several games at a time, until a
+// sequential probability ratio test decides whether A is stronger than B by the
+// hypothesized margin or not. Each side is either this build's Search with its
+// own settings (--a, --b), or another engine binary such as an older build of
+// OpenChess_uci, started as a process and driven over UCI (--engine-a,
+// --engine-b). Only the second compares two builds of the code.
+
+// Played twice each, once with either engine as White, when no openings are given
+static const char* defaultOpenings[] = {
+	"rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+	"rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+	"rnbqkbnr/pppp1ppp/4p3/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+	"rnbqkbnr/pp1ppppp/2p5/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+	"rnbqkbnr/ppp1pppp/8/3p4/3P4/8/PPP1PPPP/RNBQKBNR w KQkq - 0 2",
+	"rnbqkb1r/pppppppp/5n2/8/3P4/8/PPP1PPPP/RNBQKBNR w KQkq - 1 2",
+	"rnbqkbnr/pppppppp/8/8/2P5/8/PP1PPPPP/RNBQKBNR b KQkq - 0 1",
+	"rnbqkbnr/pppppppp/8/8/8/5N2/PPPPPPPP/RNBQKB1R b KQkq - 1 1",
+	"r1bqkbnr/pppp1ppp/2n5/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R b KQkq - 3 3",
+	"rnbqkb1r/pp1p1ppp/4pn2/2p5/2PP4/5N2/PP2PPPP/RNBQKB1R w KQkq - 0 4",
+};
+
+// Games that reach this many plies without a result are scored as draws
+constexpr int MAX_GAME_PLIES = 600;
+
+// Random legal plies played from the opening by default. With a node or depth
+// budget every game from the same position is the same, so without them a run
+// would only replay two games per opening over and over.
+constexpr int DEFAULT_RANDOM_PLIES = 4;
+
+// One side of the match: search options and evaluation, given as a comma
+// separated list such as "nonull,nolmr,nnue=net.bin,hash=64". An engine run as a
+// process gets hash, threads and nnue as UCI options; the search options only
+// apply within this build.
+struct EngineConfig {
+	std::string spec;
+	std::string path;          // engine binary, or empty to search in this process
+	SearchOptions options;
+	bool optionsChanged = false;
+	std::shared_ptr<NnueNetwork> network;
+	std::string networkPath;
+	int hash = 16;
+	int threads = 1;
+};
+
+static bool parseConfig(const std::string& spec, EngineConfig& config)
+{
+	config.spec = spec.empty() ? "default" : spec;
+	std::stringstream stream(spec);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		std::string key = item.substr(0, item.find('='));
+		std::string value = item.find('=') != std::string::npos ? item.substr(item.find('=') + 1) : "";
+		if (key == "nonull") {
+			config.options.nullMove = false;
+			config.optionsChanged = true;
+		} else if (key == "nolmr") {
+			config.options.lateMoveReductions = false;
+			config.optionsChanged = true;
+		} else if (key == "nofutility") {
+			config.options.futility = false;
+			config.optionsChanged = true;
+		} else if (key == "hash") {
+			config.hash = std::max(1, std::atoi(value.c_str()));
+		} else if (key == "threads") {
+			config.threads = std::max(1, std::atoi(value.c_str()));
+		} else if (key == "nnue") {
+			config.network = std::make_shared<NnueNetwork>();
+			if (!config.network->load(value)) {
+				std::cerr << "Cannot load network " << value << std::endl;
+				return false;
+			}
+			config.networkPath = value;
+		} else if (!key.empty()) {
+			std::cerr << "Unknown engine setting " << item << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// The opening of a game pair: the book position followed by plies random legal
+// moves, drawn from a generator seeded with seed and the pair, so both games of
+// the pair and every rerun with the same seed start alike
+static std::string pairOpening(const std::string& fen, int plies, uint64_t seed, int pair)
+{
+	Board board;
+	board.loadFen(fen);
+	std::seed_seq sequence{ static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32), static_cast<uint32_t>(pair) };
+	std::mt19937 random(sequence);
+	for (int i = 0; i < plies; ++i) {
+		MoveList moves = board.getLegalMoves();
+		if (moves.empty() || board.isDraw(0)) {
+			break;
+		}
+		board.makeMove(moves[std::uniform_int_distribution<size_t>(0, moves.size() - 1)(random)]);
+	}
+	return board.getFen();
+}
+
+enum class GameResult { WhiteWins, BlackWins, Draw, Aborted };
+
+struct Game {
+	std::string opening;
+	std::vector<Move> moves;
+	GameResult result = GameResult::Aborted;
+	std::string reason;
+};
+
+// One side of a game
+class Player
+{
+public:
+	virtual ~Player() = default;
+
+	// Each returns false when the engine has failed
+	virtual bool newGame() = 0;
+	virtual bool bestMove(const Board& board, const Game& game, const SearchLimits& limits, Move& move) = 0;
+};
+
+// This build's Search with the settings of one side
+class SearchPlayer : public Player
+{
+public:
+	explicit SearchPlayer(const EngineConfig& config) : m_search(config.hash)
+	{
+		m_search.setOptions(config.options);
+		m_search.setNetwork(config.network.get());
+		m_search.setThreads(config.threads);
+	};
+
+	bool newGame() override
+	{
+		m_search.clearHash();
+		return true;
+	};
+
+	bool bestMove(const Board& board, const Game&, const SearchLimits& limits, Move& move) override
+	{
+		move = m_search.findBestMove(board, limits);
+		return true;
+	};
+
+private:
+	Search m_search;
+};
+
+// An engine binary run as a child process and driven over UCI through its
+// standard input and output
+class UciPlayer : public Player
+{
+public:
+	~UciPlayer() override;
+
+	bool start(const EngineConfig& config);
+	bool newGame() override;
+	bool bestMove(const Board& board, const Game& game, const SearchLimits& limits, Move& move) override;
+
+private:
+	bool launch(const std::string& path);
+	bool send(std::string line);
+	bool readLine(std::string& line);
+	bool waitFor(const std::string& command, std::string& line);
+
+#ifdef _WIN32
+	HANDLE m_process = nullptr;
+	HANDLE m_toEngine = nullptr;
+	HANDLE m_fromEngine = nullptr;
+#else
+	pid_t m_pid = -1;
+	int m_toEngine = -1;
+	int m_fromEngine = -1;
+#endif
+	std::string m_buffer; // read but not yet returned by readLine()
+};
+
+#ifdef _WIN32
+
+bool UciPlayer::launch(const std::string& path)
+{
+	// The child inherits its ends of the pipes, not ours
+	SECURITY_ATTRIBUTES inherit{ sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+	HANDLE child_in = nullptr, child_out = nullptr;
+	if (!CreatePipe(&child_in, &m_toEngine, &inherit, 0)) {
+		return false;
+	}
+	if (!CreatePipe(&m_fromEngine, &child_out, &inherit, 0)) {
+		CloseHandle(child_in);
+		return false;
+	}
+	SetHandleInformation(m_toEngine, HANDLE_FLAG_INHERIT, 0);
+	SetHandleInformation(m_fromEngine, HANDLE_FLAG_INHERIT, 0);
+
+	STARTUPINFOA startup{};
+	startup.cb = sizeof(startup);
+	startup.dwFlags = STARTF_USESTDHANDLES;
+	startup.hStdInput = child_in;
+	startup.hStdOutput = child_out;
+	startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+	PROCESS_INFORMATION process{};
+	std::string command = "\"";
+	command.append(path).append("\"");
+	BOOL started = CreateProcessA(nullptr, command.data(), nullptr, nullptr, TRUE, 0, nullptr, nullptr, &startup, &process);
+	CloseHandle(child_in);
+	CloseHandle(child_out);
+	if (!started) {
+		return false;
+	}
+	CloseHandle(process.hThread);
+	m_process = process.hProcess;
+	return true;
+}
+
+UciPlayer::~UciPlayer()
+{
+	if (m_process) {
+		send("quit");
+		if (WaitForSingleObject(m_process, 1000) == WAIT_TIMEOUT) {
+			TerminateProcess(m_process, 1);
+		}
+		CloseHandle(m_process);
+	}
+	if (m_toEngine) {
+		CloseHandle(m_toEngine);
+	}
+	if (m_fromEngine) {
+		CloseHandle(m_fromEngine);
+	}
+}
+
+bool UciPlayer::send(std::string line)
+{
+	line += '\n';
+	for (size_t sent = 0; sent < line.size(); ) {
+		DWORD written = 0;
+		if (!WriteFile(m_toEngine, line.data() + sent, static_cast<DWORD>(line.size() - sent), &written, nullptr)) {
+			return false;
+		}
+		sent += written;
+	}
+	return true;
+}
+
+bool UciPlayer::readLine(std::string& line)
+{
+	size_t end;
+	while ((end = m_buffer.find('\n')) == std::string::npos) {
+		char chunk[4096];
+		DWORD count = 0;
+		if (!ReadFile(m_fromEngine, chunk, static_cast<DWORD>(sizeof(chunk)), &count, nullptr) || count == 0) {
+			return false;
+		}
+		m_buffer.append(chunk, count);
+	}
+	line.assign(m_buffer, 0, end);
+	m_buffer.erase(0, end + 1);
+	if (!line.empty() && line.back() == '\r') {
+		line.pop_back();
+	}
+	return true;
+}
+
+#else
+
+bool UciPlayer::launch(const std::string& path)
+{
+	int to_engine[2], from_engine[2];
+	if (pipe(to_engine) != 0) {
+		return false;
+	}
+	if (pipe(from_engine) != 0) {
+		close(to_engine[0]);
+		close(to_engine[1]);
+		return false;
+	}
+
+	const char* file = path.c_str();
+	pid_t pid = fork();
+	if (pid == 0) {
+		dup2(to_engine[0], STDIN_FILENO);
+		dup2(from_engine[1], STDOUT_FILENO);
+		close(to_engine[0]);
+		close(to_engine[1]);
+		close(from_engine[0]);
+		close(from_engine[1]);
+		execlp(file, file, static_cast<char*>(nullptr));
+		_exit(127);
+	}
+	close(to_engine[0]);
+	close(from_engine[1]);
+	if (pid < 0) {
+		close(to_engine[1]);
+		close(from_engine[0]);
+		return false;
+	}
+
+	// Engines started later must not hold this one's pipes open
+	fcntl(to_engine[1], F_SETFD, FD_CLOEXEC);
+	fcntl(from_engine[0], F_SETFD, FD_CLOEXEC);
+	m_pid = pid;
+	m_toEngine = to_engine[1];
+	m_fromEngine = from_engine[0];
+	return true;
+}
+
+UciPlayer::~UciPlayer()
+{
+	if (m_pid > 0) {
+		send("quit");
+		close(m_toEngine);
+		close(m_fromEngine);
+		waitpid(m_pid, nullptr, 0);
+	}
+}
+
+bool UciPlayer::send(std::string line)
+{
+	line += '\n';
+	for (size_t sent = 0; sent < line.size(); ) {
+		ssize_t written = write(m_toEngine, line.data() + sent, line.size() - sent);
+		if (written < 0 && errno != EINTR) {
+			return false;
+		}
+		sent += std::max<ssize_t>(written, 0);
+	}
+	return true;
+}
+
+bool UciPlayer::readLine(std::string& line)
+{
+	size_t end;
+	while ((end = m_buffer.find('\n')) == std::string::npos) {
+		char chunk[4096];
+		ssize_t count = read(m_fromEngine, chunk, sizeof(chunk));
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0) {
+			return false;
+		}
+		m_buffer.append(chunk, static_cast<size_t>(count));
+	}
+	line.assign(m_buffer, 0, end);
+	m_buffer.erase(0, end + 1);
+	if (!line.empty() && line.back() == '\r') {
+		line.pop_back();
+	}
+	return true;
+}
+
+#endif
+
+// Skips lines, such as info output, until one starting with the command
+bool UciPlayer::waitFor(const std::string& command, std::string& line)
+{
+	while (readLine(line)) {
+		if (line.compare(0, command.size(), command) == 0 && (line.size() == command.size() || line[command.size()] == ' ')) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool UciPlayer::start(const EngineConfig& config)
+{
+	std::string line;
+	if (!launch(config.path) || !send("uci") || !waitFor("uciok", line)) {
+		return false;
+	}
+	send("setoption name Hash value " + std::to_string(config.hash));
+	send("setoption name Threads value " + std::to_string(config.threads));
+	if (!config.networkPath.empty()) {
+		send("setoption name EvalFile value " + config.networkPath);
+	}
+	return send("isready") && waitFor("readyok", line);
+}
+
+bool UciPlayer::newGame()
+{
+	std::string line;
+	return send("ucinewgame") && send("isready") && waitFor("readyok", line);
+}
+
+bool UciPlayer::bestMove(const Board& board, const Game& game, const SearchLimits& limits, Move& move)
+{
+	std::string position = "position fen ";
+	position.append(game.opening);
+	if (!game.moves.empty()) {
+		position.append(" moves");
+		for (const Move& played : game.moves) {
+			position.append(" ").append(moveToString(played));
+		}
+	}
+
+	std::string go = limits.nodes ? "go nodes " + std::to_string(limits.nodes)
+		: limits.depth ? "go depth " + std::to_string(limits.depth)
+		: "go movetime " + std::to_string(limits.moveTimeMs);
+	std::string line, token, text;
+	if (!send(position) || !send(go) || !waitFor("bestmove", line)) {
+		return false;
+	}
+	std::istringstream stream(line);
+	stream >> token >> text;
+	return board.parseMove(text, move);
+}
+
+// Plays out the opening with white and black to move, ending it the way the
+// SDL game does: no legal move, or a draw the rules recognize. A game whose
+// engine fails is aborted with the reason set.
+static void playGame(Player& white, Player& black, const SearchLimits& limits, const std::atomic<bool>& abort, Game& game)
+{
+	Board board;
+	board.loadFen(game.opening);
+	if (!white.newGame() || !black.newGame()) {
+		game.result = GameResult::Aborted;
+		game.reason = "an engine did not answer";
+		return;
+	}
+
+	for (int ply = 0; ; ++ply) {
+		if (abort) {
+			game.result = GameResult::Aborted;
+			return;
+		}
+		if (board.getLegalMoves().empty()) {
+			bool mated = board.inCheck();
+			game.result = !mated ? GameResult::Draw
+				: (board.getSideToMove() == PieceColor::White) ? GameResult::BlackWins : GameResult::WhiteWins;
+			game.reason = mated ? "checkmate" : "stalemate";
+			return;
+		}
+		if (board.isDraw(0)) {
+			game.result = GameResult::Draw;
+			game.reason = board.isInsufficientMaterial() ? "insufficient material"
+				: board.isRepetition(0) ? "threefold repetition" : "fifty-move rule";
+			return;
+		}
+		if (ply >= MAX_GAME_PLIES) {
+			game.result = GameResult::Draw;
+			game.reason = "adjudicated after " + std::to_string(MAX_GAME_PLIES) + " plies";
+			return;
+		}
+
+		Player& player = (board.getSideToMove() == PieceColor::White) ? white : black;
+		Move move;
+		if (!player.bestMove(board, game, limits, move)) {
+			game.result = GameResult::Aborted;
+			game.reason = "an engine did not answer with a legal move";
+			return;
+		}
+		if (!move.isValid()) {
+			move = board.getLegalMoves()[0];
+		}
+		board.makeMove(move);
+		game.moves.push_back(move);
+	}
+}
+
+// Wins, draws and losses of engine A and what they say about its strength
+struct Score {
+	int wins = 0;
+	int draws = 0;
+	int losses = 0;
+
+	int games() const { return wins + draws + losses; };
+	double mean() const { return games() ? (wins + 0.5 * draws) / games() : 0.5; };
+	double variance() const
+	{
+		double m = mean();
+		return games() ? (wins * (1 - m) * (1 - m) + draws * (0.5 - m) * (0.5 - m) + losses * m * m) / games() : 0.0;
+	};
+};
+
+static double eloToScore(double elo)
+{
+	return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+static double scoreToElo(double score)
+{
+	score = std::clamp(score, 1e-6, 1 - 1e-6);
+	return 400.0 * std::log10(score / (1.0 - score));
+}
+
+// Log-likelihood ratio of H1 (A is elo1 stronger) against H0 (elo0), in the
+// normal approximation of the per-game score
+static double sprtLlr(const Score& score, double elo0, double elo1)
+{
+	double variance = score.variance();
+	if (score.games() == 0 || variance <= 0) {
+		return 0.0;
+	}
+	double s0 = eloToScore(elo0), s1 = eloToScore(elo1);
+	return (s1 - s0) * (2 * score.mean() - s0 - s1) * score.games() / (2 * variance);
+}
+
+static void printUsage()
+{
+	std::cout << "Usage: OpenChess_selfplay [options]\n"
+		<< "  --a SPEC, --b SPEC  engine settings, comma separated: nonull, nolmr, nofutility,\n"
+		<< "                      nnue=FILE, hash=MB, threads=N (default: all on, piece-square)\n"
+		<< "                      Without --engine-a/-b both sides are this build, so only\n"
+		<< "                      settings are compared, never two versions of the code.\n"
+		<< "  --engine-a PATH     run engine A as a UCI process, e.g. another build's OpenChess_uci;\n"
+		<< "  --engine-b PATH     its SPEC may only set nnue, hash and threads\n"
+		<< "  --movetime MS       time per move (default 100)\n"
+		<< "  --nodes N           nodes per move instead, for reproducible games\n"
+		<< "  --depth N           depth per move instead\n"
+		<< "  --concurrency N     games played at the same time (default: cores)\n"
+		<< "  --games N           most games to play (default 20000)\n"
+		<< "  --openings FILE     FEN or EPD lines to start from\n"
+		<< "  --random-plies N    random moves played from each opening (default 4)\n"
+		<< "  --seed S            seed of those moves (default 1)\n"
+		<< "  --elo0 E --elo1 E   SPRT hypotheses (default 0 and 5)\n"
+		<< "  --alpha P --beta P  SPRT error rates (default 0.05)\n"
+		<< "  --pgn FILE          write the games\n";
+}
+
+int main(int argc, char* argv[])
+{
+	EngineConfig configs[2];
+	std::string spec_a, spec_b, openings_path, pgn_path;
+	SearchLimits limits;
+	int concurrency = std::max(1u, std::thread::hardware_concurrency());
+	int max_games = 20000;
+	int random_plies = DEFAULT_RANDOM_PLIES;
+	uint64_t seed = 1;
+	double elo0 = 0, elo1 = 5, alpha = 0.05, beta = 0.05;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--a" && i + 1 < argc) {
+			spec_a = argv[++i];
+		} else if (arg == "--b" && i + 1 < argc) {
+			spec_b = argv[++i];
+		} else if (arg == "--engine-a" && i + 1 < argc) {
+			configs[0].path = argv[++i];
+		} else if (arg == "--engine-b" && i + 1 < argc) {
+			configs[1].path = argv[++i];
+		} else if (arg == "--movetime" && i + 1 < argc) {
+			limits.moveTimeMs = std::atoi(argv[++i]);
+		} else if (arg == "--nodes" && i + 1 < argc) {
+			limits.nodes = std::strtoull(argv[++i], nullptr, 10);
+		} else if (arg == "--depth" && i + 1 < argc) {
+			limits.depth = std::atoi(argv[++i]);
+		} else if (arg == "--concurrency" && i + 1 < argc) {
+			concurrency = std::max(1, std::atoi(argv[++i]));
+		} else if (arg == "--games" && i + 1 < argc) {
+			max_games = std::max(2, std::atoi(argv[++i]));
+		} else if (arg == "--openings" && i + 1 < argc) {
+			openings_path = argv[++i];
+		} else if (arg == "--random-plies" && i + 1 < argc) {
+			random_plies = std::max(0, std::atoi(argv[++i]));
+		} else if (arg == "--seed" && i + 1 < argc) {
+			seed = std::strtoull(argv[++i], nullptr, 10);
+		} else if (arg == "--elo0" && i + 1 < argc) {
+			elo0 = std::atof(argv[++i]);
+		} else if (arg == "--elo1" && i + 1 < argc) {
+			elo1 = std::atof(argv[++i]);
+		} else if (arg == "--alpha" && i + 1 < argc) {
+			alpha = std::atof(argv[++i]);
+		} else if (arg == "--beta" && i + 1 < argc) {
+			beta = std::atof(argv[++i]);
+		} else if (arg == "--pgn" && i + 1 < argc) {
+			pgn_path = argv[++i];
+		} else {
+			printUsage();
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+	if (!parseConfig(spec_a, configs[0]) || !parseConfig(spec_b, configs[1])) {
+		return 1;
+	}
+	for (EngineConfig& config : configs) {
+		if (config.path.empty()) {
+			continue;
+		}
+		if (config.optionsChanged) {
+			std::cerr << "nonull, nolmr and nofutility only apply to this build, not to " << config.path << std::endl;
+			return 1;
+		}
+		config.spec = (config.spec == "default") ? config.path : std::string(config.path).append(" ").append(config.spec);
+	}
+	if (!limits.moveTimeMs && !limits.nodes && !limits.depth) {
+		limits.moveTimeMs = 100;
+	}
+
+	std::vector<std::string> openings;
+	if (!openings_path.empty()) {
+		std::ifstream file(openings_path);
+		std::string line;
+		while (std::getline(file, line)) {
+			if (line.find_first_not_of(" \t\r") == std::string::npos || line[0] == '#') {
+				continue;
+			}
+			// EPD lines carry operations where a FEN has its clocks
+			Board board;
+			std::istringstream stream(line);
+			std::string fields[4];
+			stream >> fields[0] >> fields[1] >> fields[2] >> fields[3];
+			if (board.loadFen(line) || board.loadFen(fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3])) {
+				openings.push_back(board.getFen());
+			}
+		}
+		if (openings.empty()) {
+			std::cerr << "No positions in " << openings_path << std::endl;
+			return 1;
+		}
+	} else {
+		openings.assign(std::begin(defaultOpenings), std::end(defaultOpenings));
+	}
+
+	// Repeated games would count as new evidence in the test
+	int distinct_games = 2 * static_cast<int>(openings.size());
+	if (random_plies == 0 && (limits.nodes || limits.depth) && max_games > distinct_games) {
+		std::cerr << "With --nodes or --depth and no random plies only " << distinct_games << " distinct games exist; "
+			<< "playing that many" << std::endl;
+		max_games = distinct_games;
+	}
+
+	double lower = std::log(beta / (1 - alpha));
+	double upper = std::log((1 - beta) / alpha);
+	std::cout << "A: " << configs[0].spec << ", B: " << configs[1].spec << ", " << openings.size() << " openings, "
+		<< random_plies << " random plies, " << concurrency << " games at a time, SPRT elo0 " << elo0 << " elo1 " << elo1 << ", bounds ["
+		<< std::fixed << std::setprecision(2) << lower << ", " << upper << "]" << std::endl;
+
+	std::ofstream pgn;
+	if (!pgn_path.empty()) {
+		pgn.open(pgn_path, std::ios::binary);
+	}
+
+	// Game n is played from the opening of pair n / 2, with A as White when n is even
+	std::atomic<int> next_game{ 0 };
+	std::atomic<bool> decided{ false };
+	std::mutex result_mutex;
+	Score score;
+	std::string verdict;
+
+	auto worker = [&](Player& player_a, Player& player_b) {
+		Player* players[2] = { &player_a, &player_b };
+		for (int n = next_game++; n < max_games && !decided; n = next_game++) {
+			Game game;
+			game.opening = pairOpening(openings[(n / 2) % openings.size()], random_plies, seed, n / 2);
+			bool a_white = (n % 2 == 0);
+			playGame(*players[a_white ? 0 : 1], *players[a_white ? 1 : 0], limits, decided, game);
+			if (game.result == GameResult::Aborted) {
+				// Stopped by the test, or an engine failed, which ends the match
+				std::lock_guard<std::mutex> lock(result_mutex);
+				if (!game.reason.empty() && !decided) {
+					verdict = "Stopped: " + game.reason;
+					decided = true;
+				}
+				continue;
+			}
+
+			std::lock_guard<std::mutex> lock(result_mutex);
+			if (decided) {
+				continue; // finished after the test stopped
+			}
+			bool a_won = (game.result == GameResult::WhiteWins) == a_white;
+			if (game.result == GameResult::Draw) {
+				score.draws++;
+			} else if (a_won) {
+				score.wins++;
+			} else {
+				score.losses++;
+			}
+
+			double llr = sprtLlr(score, elo0, elo1);
+			double margin = 1.96 * std::sqrt(score.variance() / score.games());
+			const char* winner = (game.result == GameResult::Draw) ? "-" : a_won ? "A" : "B";
+			std::cout << "Game " << score.games() << ": " << winner
+				<< " (" << game.reason << ", " << game.moves.size() << " plies)  W-D-L " << score.wins << "-" << score.draws << "-" << score.losses
+				<< "  Elo " << scoreToElo(score.mean()) << " +- " << (scoreToElo(score.mean() + margin) - scoreToElo(score.mean()))
+				<< "  LLR " << llr << std::endl;
+
+			if (pgn) {
+				const char* result = game.result == GameResult::WhiteWins ? "1-0" : game.result == GameResult::BlackWins ? "0-1" : "1/2-1/2";
+				std::vector<std::pair<std::string, std::string>> tags = {
+					{ "Event", "OpenChess self-play" }, { "Site", "?" }, { "Date", "????.??.??" }, { "Round", std::to_string(n + 1) },
+					{ "White", a_white ? "A " + configs[0].spec : "B " + configs[1].spec },
+					{ "Black", a_white ? "B " + configs[1].spec : "A " + configs[0].spec },
+					{ "Result", result }, { "Termination", game.reason }
+				};
+				pgn << writePgn(tags, game.opening, game.moves, result);
+			}
+
+			if (llr >= upper || llr <= lower) {
+				verdict = (llr >= upper) ? "H1 accepted: A is stronger" : "H0 accepted: A is not stronger";
+				decided = true;
+			}
+		}
+	};
+
+	// Two players per worker, all started before the games. Engine processes get
+	// their own copies of hash, threads and network, like the in-process sides.
+#ifndef _WIN32
+	std::signal(SIGPIPE, SIG_IGN); // a dead engine shows as a failed write instead
+#endif
+	std::vector<std::unique_ptr<Player>> players;
+	for (int i = 0; i < 2 * concurrency; ++i) {
+		const EngineConfig& config = configs[i % 2];
+		if (config.path.empty()) {
+			players.push_back(std::make_unique<SearchPlayer>(config));
+			continue;
+		}
+		auto engine = std::make_unique<UciPlayer>();
+		if (!engine->start(config)) {
+			std::cerr << "Cannot start UCI engine " << config.path << std::endl;
+			return 1;
+		}
+		players.push_back(std::move(engine));
+	}
+
+	std::vector<std::thread> pool;
+	for (int i = 0; i < concurrency; ++i) {
+		pool.emplace_back(worker, std::ref(*players[2 * i]), std::ref(*players[2 * i + 1]));
+	}
+	for (std::thread& thread : pool) {
+		thread.join();
+	}
+
+	std::cout << (verdict.empty() ? "No decision within " + std::to_string(max_games) + " games" : verdict)
+		<< ", " << score.games() << " games, W-D-L " << score.wins << "-" << score.draws << "-" << score.losses
+		<< ", Elo " << scoreToElo(score.mean()) << std::endl;
+	return 0;
+}
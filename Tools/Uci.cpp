@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "Board.h"
+#include "Search.h"
+
+// Headless engine speaking the Universal Chess Interface over stdin and stdout.
+// The search runs on its own thread while this one keeps reading commands, so
+// stop, ponderhit and isready are answered at once.
+
+// Time kept back for the GUI and the pipe when playing on the clock
+constexpr int MOVE_OVERHEAD_MS = 50;
+// Moves the remaining time is spread over when the GUI does not say
+constexpr int DEFAULT_MOVES_TO_GO = 30;
+
+static Search search;
+static Board board;
+static std::unique_ptr<NnueNetwork> network;
+
+// Lines from the search thread and from this one must not interleave
+static std::mutex outputMutex;
+
+// The reporter thread waits for the search to end and sends bestmove. In infinite
+// and ponder mode, bestmove must wait for stop or ponderhit even when the search
+// ended by itself.
+static std::thread reporter;
+static std::mutex holdMutex;
+static std::condition_variable holdReleased;
+static bool holdBestMove = false;
+
+// Side to move at the root, since the search scores from White's point of view
+static PieceColor rootSide = PieceColor::White;
+
+static void send(const std::string& line)
+{
+	std::lock_guard<std::mutex> lock(outputMutex);
+	std::cout << line << std::endl;
+}
+
+static std::string formatScore(int score)
+{
+	if (rootSide == PieceColor::Black) {
+		score = -score;
+	}
+	if (score >= MATE_BOUND) {
+		return "mate " + std::to_string((MATE_SCORE - score + 1) / 2);
+	}
+	if (score <= -MATE_BOUND) {
+		return "mate -" + std::to_string((MATE_SCORE + score) / 2);
+	}
+	return "cp " + std::to_string(score);
+}
+
+static void sendInfo(const SearchInfo& info)
+{
+	std::ostringstream line;
+	uint64_t nps = info.timeMs > 0 ? info.nodes * 1000 / info.timeMs : 0;
+	line << "info depth " << info.depth << " score " << formatScore(info.score) << " nodes " << info.nodes
+		<< " nps " << nps << " time " << info.timeMs << " pv";
+	for (const Move& move : info.pv) {
+		line << " " << moveToString(move);
+	}
+	send(line.str());
+}
+
+static void releaseBestMove()
+{
+	std::lock_guard<std::mutex> lock(holdMutex);
+	holdBestMove = false;
+	holdReleased.notify_all();
+}
+
+// Only this thread calls into the search other than stop() and ponderHit(), so
+// the reporter must be joined before the next start() or wait()
+static void stopSearch()
+{
+	search.stop();
+	releaseBestMove();
+	if (reporter.joinable()) {
+		reporter.join();
+	}
+}
+
+static void setPosition(std::istringstream& stream)
+{
+	std::string token, fen;
+	stream >> token;
+	if (token == "startpos") {
+		fen = START_FEN;
+		stream >> token; // "moves", if any
+	} else if (token == "fen") {
+		while (stream >> token && token != "moves") {
+			fen += token + " ";
+		}
+	} else {
+		return;
+	}
+
+	if (!board.loadFen(fen)) {
+		send("info string invalid fen " + fen);
+		board.loadFen(START_FEN);
+		return;
+	}
+
+	// Played one by one, so the history is there to spot repetitions
+	while (stream >> token) {
+		Move move;
+		if (!board.parseMove(token, move)) {
+			send("info string illegal move " + token);
+			return;
+		}
+		board.makeMove(move);
+	}
+}
+
+// Spends a share of the remaining time, plus most of the increment, and always
+// keeps the overhead in hand
+static int allocateTime(int time_left, int increment, int moves_to_go)
+{
+	int moves = moves_to_go > 0 ? moves_to_go : DEFAULT_MOVES_TO_GO;
+	int budget = time_left / moves + increment * 3 / 4;
+	return std::max(1, std::min(budget, time_left - MOVE_OVERHEAD_MS));
+}
+
+static void go(std::istringstream& stream)
+{
+	stopSearch();
+
+	SearchLimits limits;
+	int wtime = 0, btime = 0, winc = 0, binc = 0, moves_to_go = 0;
+	bool infinite = false;
+	std::string token;
+	while (stream >> token) {
+		if (token == "depth") stream >> limits.depth;
+		else if (token == "nodes") stream >> limits.nodes;
+		else if (token == "movetime") stream >> limits.moveTimeMs;
+		else if (token == "wtime") stream >> wtime;
+		else if (token == "btime") stream >> btime;
+		else if (token == "winc") stream >> winc;
+		else if (token == "binc") stream >> binc;
+		else if (token == "movestogo") stream >> moves_to_go;
+		else if (token == "infinite") infinite = true;
+		else if (token == "ponder") limits.ponder = true;
+	}
+
+	rootSide = board.getSideToMove();
+	int time_left = (rootSide == PieceColor::White) ? wtime : btime;
+	int increment = (rootSide == PieceColor::White) ? winc : binc;
+	if (time_left > 0 && limits.moveTimeMs == 0) {
+		limits.moveTimeMs = allocateTime(time_left, increment, moves_to_go);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(holdMutex);
+		holdBestMove = infinite || limits.ponder;
+	}
+
+	search.start(board, limits);
+	reporter = std::thread([]() {
+		Move best = search.wait();
+		{
+			std::unique_lock<std::mutex> lock(holdMutex);
+			holdReleased.wait(lock, []() { return !holdBestMove; });
+		}
+
+		const SearchStats& stats = search.getLastStats();
+		std::string line = "bestmove " + (best.isValid() ? moveToString(best) : std::string("0000"));
+		if (stats.pv.size() >= 2) {
+			line += " ponder " + moveToString(stats.pv[1]);
+		}
+		send(line);
+	});
+}
+
+static void setOption(std::istringstream& stream)
+{
+	// setoption name <id> [value <x>], where the id may contain spaces
+	std::string token, name, value;
+	stream >> token;
+	while (stream >> token && token != "value") {
+		name += (name.empty() ? "" : " ") + token;
+	}
+	std::getline(stream >> std::ws, value);
+
+	stopSearch();
+	if (name == "Hash") {
+		search.setHashSize(std::max(1, std::atoi(value.c_str())));
+	} else if (name == "Threads") {
+		search.setThreads(std::atoi(value.c_str()));
+	} else if (name == "EvalFile") {
+		if (value.empty() || value == "<empty>") {
+			network.reset();
+			search.setNetwork(nullptr);
+			return;
+		}
+		auto loaded = std::make_unique<NnueNetwork>();
+		if (!loaded->load(value)) {
+			send("info string cannot load network " + value);
+			return;
+		}
+		search.setNetwork(loaded.get());
+		network = std::move(loaded);
+		send(std::string("info string NNUE evaluation using ") + NnueNetwork::kernelName());
+	} else if (name != "Ponder") {
+		send("info string unknown option " + name);
+	}
+}
+
+int main()
+{
+	search.setInfoCallback(sendInfo);
+	board.loadFen(START_FEN);
+
+	std::string line;
+	while (std::getline(std::cin, line)) {
+		std::istringstream stream(line);
+		std::string command;
+		stream >> command;
+
+		if (command == "uci") {
+			send("id name OpenChess");
+			send("id author spiroskou");
+			send("option name Hash type spin default " + std::to_string(search.getHashSize()) + " min 1 max 4096");
+			send("option name Threads type spin default 1 min 1 max 256");
+			send("option name Ponder type check default false");
+			send("option name EvalFile type string default <empty>");
+			send("uciok");
+		} else if (command == "isready") {
+			send("readyok");
+		} else if (command == "ucinewgame") {
+			stopSearch();
+			search.clearHash();
+			board.loadFen(START_FEN);
+		} else if (command == "position") {
+			setPosition(stream);
+		} else if (command == "go") {
+			go(stream);
+		} else if (command == "stop") {
+			stopSearch();
+		} else if (command == "ponderhit") {
+			search.ponderHit();
+			releaseBestMove();
+		} else if (command == "setoption") {
+			setOption(stream);
+		} else if (command == "quit") {
+			break;
+		}
+	}
+
+	stopSearch();
+	return 0;
+}
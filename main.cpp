@@ -3,9 +3,31 @@
 #endif
 #include "ChessSDL.h"
 #include <SDL.h> // for linking error
+#include <cstdlib>
+#include <iostream>
+#include <string>
 
 int main(int argc, char* args[])
 {
+    // Optional engine settings, e.g. "--hash 64" for a 64 MB transposition table
+    // "--threads 8" to search with eight threads, "--movetime 2000" for two seconds per AI move,
+    // "--nnue file" to evaluate with a network, or "--pgn file" for where the game is saved
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(args[i]) == "--hash") {
+            ChessSDL_SetHashSize(std::atoi(args[++i]));
+        } else if (std::string(args[i]) == "--threads") {
+            ChessSDL_SetSearchThreads(std::atoi(args[++i]));
+        } else if (std::string(args[i]) == "--movetime") {
+            ChessSDL_SetMoveTime(std::atoi(args[++i]));
+        } else if (std::string(args[i]) == "--nnue") {
+            if (!ChessSDL_LoadNetwork(args[++i])) {
+                std::cerr << "Cannot load network " << args[i] << ", using the built-in evaluation" << std::endl;
+            }
+        } else if (std::string(args[i]) == "--pgn") {
+            ChessSDL_SetPgnFile(args[++i]);
+        }
+    }
+
     if (ChessSDL_MakePreparations()) {
         return 1;
     }